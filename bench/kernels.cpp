@@ -0,0 +1,104 @@
+// by: Zhiping
+//
+// Microbenchmark of the bit-vector kernels (src/bitvector.cpp): every
+// variant the CPU runs, on rows of 64 to 64k values, after checking that
+// it computes the same rows as the scalar one. Times are per call, over a
+// pool of rows large enough to leave the L1 cache at the larger sizes.
+//
+// Usage: bin/bench_kernels [MILLISECONDS per measurement]
+
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+
+#include <bitvector.h>
+
+using namespace L2;
+
+static const int ROWS = 64;
+
+struct Pool {
+  int words;
+  std::vector<word_t> data;
+
+  Pool(int words, std::mt19937_64 & rng) : words(words), data((std::size_t)ROWS * words) {
+    for (auto & w : data) {
+      w = rng() & rng(); // about a quarter of the bits set
+    }
+  }
+
+  word_t *row(int r) {
+    return &data[(std::size_t)(r % ROWS) * words];
+  }
+};
+
+// Calls f(i) for i = 0, 1, ... for about ms milliseconds; returns the
+// nanoseconds per call.
+template< typename F >
+double measure(int ms, F f) {
+  auto start = std::chrono::steady_clock::now();
+  std::chrono::duration<double> d(0);
+  int64_t calls = 0;
+  for (int batch = 1; d.count() * 1e3 < ms; batch *= 2) {
+    for (int i = 0; i < batch; i++) {
+      f(calls + i);
+    }
+    calls += batch;
+    d = std::chrono::steady_clock::now() - start;
+  }
+  return d.count() * 1e9 / calls;
+}
+
+static bool check(const BitKernels & k, const BitKernels & scalar, int words, std::mt19937_64 & rng) {
+  Pool p(words, rng);
+  std::vector<word_t> a(p.row(0), p.row(0) + words), b = a;
+  k.transfer(&a[0], p.row(1), p.row(2), p.row(3), words);
+  scalar.transfer(&b[0], p.row(1), p.row(2), p.row(3), words);
+  bool ok = a == b;
+  const word_t *rows[3] = {p.row(4), p.row(5), p.row(6)};
+  ok = ok && k.unite_n(&a[0], rows, 3, words) == scalar.unite_n(&b[0], rows, 3, words) && a == b;
+  ok = ok && !k.unite_n(&a[0], rows, 3, words);
+  k.unite(&a[0], p.row(7), words);
+  scalar.unite(&b[0], p.row(7), words);
+  ok = ok && a == b;
+  ok = ok && k.unite_changed(&a[0], p.row(11), words) == scalar.unite_changed(&b[0], p.row(11), words) && a == b;
+  ok = ok && !k.unite_changed(&a[0], p.row(11), words);
+  bool changed = k.transfer_changed(&a[0], p.row(8), p.row(9), p.row(10), words);
+  scalar.transfer(&b[0], p.row(8), p.row(9), p.row(10), words);
+  ok = ok && a == b && changed == true && !k.transfer_changed(&a[0], p.row(8), p.row(9), p.row(10), words);
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  int ms = argc > 1 ? std::atoi(argv[1]) : 100;
+  std::vector<const BitKernels *> kernels = bv_supported_kernels();
+  const BitKernels & scalar = *kernels.back();
+  std::mt19937_64 rng(1);
+
+  std::printf("kernels at startup: %s\n", bv_kernels->name);
+  std::printf("%8s %-8s %12s %12s %12s\n", "values", "kernel", "transfer ns", "union3 ns", "changed ns");
+  for (int values = 64; values <= 65536; values *= 4) {
+    int words = bv_words(values);
+    Pool p(words, rng);
+    for (auto k : kernels) {
+      if (!check(*k, scalar, words, rng)) {
+        std::printf("%8d %-8s differs from scalar\n", values, k->name);
+        return 1;
+      }
+      double transfer = measure(ms, [&](int64_t i) {
+        k->transfer(p.row(i), p.row(i + 1), p.row(i + 2), p.row(i + 3), words);
+      });
+      double unite = measure(ms, [&](int64_t i) {
+        const word_t *rows[3] = {p.row(i + 1), p.row(i + 2), p.row(i + 3)};
+        k->unite_n(p.row(i), rows, 3, words);
+      });
+      double changed = measure(ms, [&](int64_t i) {
+        k->transfer_changed(p.row(i), p.row(i + 1), p.row(i + 2), p.row(i + 3), words);
+      });
+      std::printf("%8d %-8s %12.1f %12.1f %12.1f\n", values, k->name, transfer, unite, changed);
+    }
+  }
+  return 0;
+}
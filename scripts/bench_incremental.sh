@@ -0,0 +1,23 @@
+#!/bin/bash
+#
+# Measures edit-then-query latency of the incremental engine on one
+# generated function of INSTRUCTIONS instructions, against the full solve
+# it replaces: ./bin/L2 -u EDITS replays that many random local edits
+# (spill stores and loads, removals, operand rewrites), asking one liveness
+# question after each. Shapes are structured loops and loops with extra
+# exits (-g).
+#
+# Usage: scripts/bench_incremental.sh [INSTRUCTIONS] [EDITS]
+
+instructions=${1:-100000} ;
+edits=${2:-1000} ;
+
+input=`mktemp /tmp/bench_incremental.XXXXXX.L2f` ;
+stats=`mktemp /tmp/bench_incremental.XXXXXX.stats` ;
+trap "rm -f $input $stats" EXIT ;
+
+for flags in "-g 0" "-g 0.1" ; do
+  ./scripts/gen_L2.py -n $instructions $flags > $input ;
+  ./bin/L2 -s -u $edits -e incremental $input 2>$stats >/dev/null ;
+  echo "$instructions instructions, $flags:`grep " local edits, " $stats`" ;
+done
@@ -0,0 +1,24 @@
+#!/bin/bash
+#
+# Compares the read-based and the mmap-based input paths on a generated
+# program: wall time, parse time and peak RSS of ./bin/L2 for each mode.
+#
+# Usage: scripts/bench_input.sh [FUNCTIONS] [INSTRUCTIONS_PER_FUNCTION]
+
+functions=${1:-100} ;
+instructions=${2:-5000} ;
+
+input=`mktemp /tmp/bench_input.XXXXXX.L2` ;
+stats=`mktemp /tmp/bench_input.XXXXXX.stats` ;
+trap "rm -f $input $stats" EXIT ;
+TIMEFORMAT="%R" ;
+
+./scripts/gen_L2.py -f $functions -n $instructions > $input ;
+echo "input: `du -h $input | cut -f1` ($functions functions x $instructions instructions)" ;
+
+for mode in read mmap ; do
+  wall=`{ time ./bin/L2 -p -s -m $mode $input 2>$stats >/dev/null ; } 2>&1` ;
+  parse=`grep "^parse" $stats | cut -d' ' -f2` ;
+  rss=`grep "^peak RSS" $stats | cut -d' ' -f3` ;
+  echo "$mode: wall $wall s, parse $parse s, peak RSS $rss kB" ;
+done
@@ -0,0 +1,34 @@
+#!/bin/bash
+#
+# Scales the liveness test corpus up into one large function (the bodies of
+# tests/liveness/*.L2f repeated COPIES times, labels renamed apart) and
+# reports the IR footprint per instruction and the GEN/KILL time.
+#
+# Usage: scripts/bench_ir.sh [COPIES]
+
+copies=${1:-2000} ;
+
+input=`mktemp /tmp/bench_ir.XXXXXX.L2f` ;
+stats=`mktemp /tmp/bench_ir.XXXXXX.stats` ;
+trap "rm -f $input $stats" EXIT ;
+
+{
+  echo "(:bench" ;
+  echo "  0 0" ;
+  for c in `seq $copies` ; do
+    t=0 ;
+    for f in tests/liveness/*.L2f ; do
+      let t=$t+1 ;
+      sed -e '1,2d' -e '$d' -e "s/:\([A-Za-z_][A-Za-z_0-9]*\)/:\1_${c}_${t}/g" $f ;
+    done
+  done
+  echo ")" ;
+} > $input ;
+
+./bin/L2 -s $input 2>$stats >/dev/null ;
+
+instructions=`grep "^:bench" $stats | cut -d' ' -f2` ;
+arena=`grep "^parse" $stats | sed "s/.*IR \([0-9]*\) kB/\1/"` ;
+echo "instructions: $instructions" ;
+echo "IR: $arena kB (`expr $arena \* 1024 / $instructions` bytes per instruction)" ;
+grep "^:bench" $stats | sed "s/.*gen\/kill \([^ ]*\) s.*/gen\/kill: \1 s/" ;
@@ -0,0 +1,34 @@
+#!/bin/bash
+#
+# Compares the liveness engines (std::set<std::string>, pure bit-vector and
+# hybrid sparse/dense sets) on a sparse function, where a sliding window
+# keeps only a few values live, and on a dense one, where a large pool of
+# variables stays live across loops: wall time, bytes held by the IN and OUT
+# sets and peak RSS of ./bin/L2.
+# The set engine sweeps the whole function until nothing changes, so leave
+# it out of ENGINES for large INSTRUCTIONS.
+#
+# Usage: scripts/bench_liveset.sh [INSTRUCTIONS] [VARIABLES] [ENGINES]
+
+instructions=${1:-300} ;
+vars=${2:-256} ;
+engines=${3:-"set bitvector hybrid"} ;
+
+sparse=`mktemp /tmp/bench_liveset.XXXXXX.L2f` ;
+dense=`mktemp /tmp/bench_liveset.XXXXXX.L2f` ;
+stats=`mktemp /tmp/bench_liveset.XXXXXX.stats` ;
+trap "rm -f $sparse $dense $stats" EXIT ;
+TIMEFORMAT="%R" ;
+
+./scripts/gen_L2.py -n $instructions -w 8 > $sparse ;
+./scripts/gen_L2.py -n $instructions -v $vars > $dense ;
+
+for input in sparse dense ; do
+  echo "$input: $instructions instructions" ;
+  for engine in $engines ; do
+    wall=`{ time ./bin/L2 -s -e $engine ${!input} 2>$stats >/dev/null ; } 2>&1` ;
+    sets=`grep "^:" $stats | sed "s/.*sets \([0-9]*\) kB/\1/"` ;
+    rss=`grep "^peak RSS" $stats | cut -d' ' -f3` ;
+    echo "  $engine: wall $wall s, sets $sets kB, peak RSS $rss kB" ;
+  done
+done
@@ -0,0 +1,29 @@
+#!/bin/bash
+#
+# Parse throughput on a variable-dense generated function: LINES
+# instructions over a pool of VARS variables, few of them loops or numbers.
+# Reports the best parse time of three runs of ./bin/L2 and the MB/s it
+# amounts to.
+#
+# Usage: scripts/bench_parse.sh [LINES] [VARS]
+
+lines=${1:-100000} ;
+vars=${2:-512} ;
+
+input=`mktemp /tmp/bench_parse.XXXXXX.L2f` ;
+stats=`mktemp /tmp/bench_parse.XXXXXX.stats` ;
+trap "rm -f $input $stats" EXIT ;
+
+./scripts/gen_L2.py -n $lines -v $vars -l 0.05 > $input ;
+bytes=`stat -c %s $input` ;
+echo "input: `wc -l < $input` lines, `expr $bytes / 1024` kB, $vars variables" ;
+
+best="" ;
+for run in 1 2 3 ; do
+  ./bin/L2 -s -m read $input 2>$stats >/dev/null ;
+  parse=`grep "^parse" $stats | cut -d' ' -f2` ;
+  if test -z "$best" || awk "BEGIN { exit !($parse < $best) }" ; then
+    best=$parse ;
+  fi
+done
+echo "parse: $best s, `awk -v b=$bytes -v t=$best 'BEGIN { printf "%.1f", b / t / 1e6 }'` MB/s" ;
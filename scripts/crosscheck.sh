@@ -0,0 +1,46 @@
+#!/bin/bash
+#
+# Compares the output of ENGINE against REFERENCE on the liveness test
+# corpus and on generated programs: structured ones, ones with extra loop
+# exits (-g), and ones with extra loop entries too (-g -i), which are
+# irreducible. OPTIONS are passed to both runs.
+#
+# Usage: scripts/crosscheck.sh [ENGINE] [REFERENCE] [SEEDS] [INSTRUCTIONS] [OPTIONS]
+
+engine=${1:-forest} ;
+reference=${2:-bitvector} ;
+seeds=${3:-5} ;
+instructions=${4:-20000} ;
+options=${5:-} ;
+
+input=`mktemp /tmp/crosscheck.XXXXXX.L2` ;
+trap "rm -f $input" EXIT ;
+
+passed=0 ;
+failed=0 ;
+check () {
+  if cmp -s <(./bin/L2 $options -e $engine "$@") <(./bin/L2 $options -e $reference "$@") ; then
+    let passed=$passed+1 ;
+  else
+    echo "$*: Failed" ;
+    let failed=$failed+1 ;
+  fi
+}
+
+for i in tests/liveness/*.L2f ; do
+  check $i ;
+done
+for i in tests/liveness/*.L2 ; do
+  check -p $i ;
+done
+
+for seed in `seq $seeds` ; do
+  for flags in "-g 0" "-g 0.1" "-g 0.05 -i" ; do
+    ./scripts/gen_L2.py -f 4 -n $instructions $flags -s $seed > $input ;
+    check -p $input ;
+  done
+done
+
+let total=$passed+$failed ;
+echo "$engine against $reference: $passed out of $total identical" ;
+test $failed -eq 0
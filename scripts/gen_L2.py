@@ -0,0 +1,170 @@
+#!/usr/bin/env python3
+# by: Zhiping
+#
+# Generates synthetic L2 sources for the benchmarks and stress tests.
+#
+# Every function is a sequence of straight-line runs and (nested) loops over
+# a pool of variables, with calls to the runtime sprinkled in. The output is
+# a single (:f ...) function, or a whole (:main ...) program with -p.
+#
+# With -w the pool is a window of that many variables sliding over fresh
+# names as the function goes on, each defined as it enters the window, so
+# only a few values are live at any point (sparse live sets).
+#
+# With -g some straight-line runs branch forward to a label placed at the
+# start of a later run, in the same loop or outside it, so loops get extra
+# exits. With -i as well the label may also land inside a later loop, which
+# gives loops extra entries and makes the CFG irreducible.
+
+import argparse
+import random
+import sys
+
+CMP = ["<", "<=", "="]
+AOP = ["+=", "-=", "*=", "&="]
+
+
+class Function:
+    def __init__(self, name, args, rng):
+        self.name = name
+        self.args = args
+        self.rng = rng
+        self.lines = []
+        self.labels = 0
+        self.count = 0
+        self.defined = 0
+        self.pending = []
+        self.loops = []
+
+    def var(self):
+        if self.args.window:
+            return "v%d" % (self.count // 4 + self.rng.randrange(self.args.window))
+        return "v%d" % self.rng.randrange(self.args.vars)
+
+    def slide(self):
+        # Define the variables entering the window before their first use.
+        while self.defined < self.count // 4 + self.args.window:
+            self.lines.append("    (v%d <- %d)" % (self.defined, self.defined % 16))
+            self.defined += 1
+
+    def value(self):
+        if self.rng.random() < 0.2:
+            return str(self.rng.randrange(-16, 16))
+        return self.var()
+
+    def label(self):
+        self.labels += 1
+        return ":L%d" % self.labels
+
+    def emit(self, line):
+        self.lines.append("    " + line)
+
+    def place_pending(self):
+        # A label is only placed inside the loops its branch is in, unless
+        # irreducible flow is allowed.
+        here = len(self.loops)
+        for target in list(self.pending):
+            label, loops = target
+            if (self.args.irreducible or loops[:here] == self.loops) and self.rng.random() < 0.5:
+                self.pending.remove(target)
+                self.lines.append("    " + label)
+
+    def straight(self, count):
+        rng = self.rng
+        self.place_pending()
+        if self.args.gotos and rng.random() < self.args.gotos:
+            target, next_ = self.label(), self.label()
+            self.pending.append((target, list(self.loops)))
+            self.emit("(cjump %s %s %s %s %s)" % (self.var(), rng.choice(CMP), self.value(), target, next_))
+            self.lines.append("    " + next_)
+        for _ in range(count):
+            self.count += 1
+            if self.args.window:
+                self.slide()
+            r = rng.random()
+            if r < 0.30:
+                self.emit("(%s <- %s)" % (self.var(), self.value()))
+            elif r < 0.55:
+                self.emit("(%s %s %s)" % (self.var(), rng.choice(AOP), self.value()))
+            elif r < 0.65:
+                self.emit("(%s <- %s %s %s)" % (self.var(), self.value(), rng.choice(CMP), self.value()))
+            elif r < 0.72:
+                self.emit("(%s <- (mem %s %d))" % (self.var(), self.var(), 8 * rng.randrange(8)))
+            elif r < 0.79:
+                self.emit("((mem %s %d) <- %s)" % (self.var(), 8 * rng.randrange(8), self.value()))
+            elif r < 0.84:
+                self.emit("(%s @ %s %s %d)" % (self.var(), self.var(), self.var(), rng.choice([2, 4, 8])))
+            elif r < 0.88:
+                self.emit("(%s %s)" % (self.var(), rng.choice(["++", "--"])))
+            elif r < 0.92:
+                self.emit("(rdi <- %s)" % self.var())
+                self.emit("(call print 1)")
+            elif r < 0.95:
+                self.emit("(rdi <- %s)" % self.value())
+                self.emit("(rsi <- %s)" % self.value())
+                self.emit("(call allocate 2)")
+                self.emit("(%s <- rax)" % self.var())
+            else:
+                self.emit("(%s <<= %s)" % (self.var(), rng.choice(["rcx", str(rng.randrange(1, 8))])))
+
+    def region(self, budget, depth):
+        # Spend roughly `budget` instructions on straight-line runs and loops.
+        rng = self.rng
+        while budget > 0:
+            run = min(budget, rng.randrange(1, 2 * self.args.block + 1))
+            if depth < self.args.depth and run > 4 and rng.random() < self.args.loops:
+                head, exit_ = self.label(), self.label()
+                self.lines.append("    " + head)
+                self.loops.append(head)
+                self.region(run - 2, depth + 1)
+                self.loops.pop()
+                self.emit("(cjump %s %s %s %s %s)" % (self.var(), rng.choice(CMP), self.value(), head, exit_))
+                self.lines.append("    " + exit_)
+            else:
+                self.straight(run)
+            budget -= run
+
+    def generate(self):
+        self.lines.append("  (:%s" % self.name)
+        self.lines.append("    0 0")
+        if not self.args.window:
+            for v in range(min(self.args.vars, 6)):
+                self.emit("(v%d <- %d)" % (v, v))
+        self.region(self.args.instructions, 0)
+        for label, _ in self.pending:
+            self.lines.append("    " + label)
+        self.emit("(rax <- %s)" % self.var())
+        self.emit("(return)")
+        self.lines.append("  )")
+        return self.lines
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate synthetic L2 sources.")
+    parser.add_argument("-p", "--program", action="store_true", help="emit a whole program instead of one function")
+    parser.add_argument("-f", "--functions", type=int, default=1, help="number of functions (implies -p when > 1)")
+    parser.add_argument("-n", "--instructions", type=int, default=1000, help="instructions per function")
+    parser.add_argument("-v", "--vars", type=int, default=32, help="variables per function")
+    parser.add_argument("-w", "--window", type=int, default=0, help="use a sliding window of this many variables")
+    parser.add_argument("-b", "--block", type=int, default=20, help="mean straight-line run length")
+    parser.add_argument("-d", "--depth", type=int, default=4, help="maximum loop nesting depth")
+    parser.add_argument("-l", "--loops", type=float, default=0.3, help="probability that a run becomes a loop")
+    parser.add_argument("-g", "--gotos", type=float, default=0.0, help="probability that a run starts with a forward branch")
+    parser.add_argument("-i", "--irreducible", action="store_true", help="let -g branch into later loops")
+    parser.add_argument("-s", "--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    out = sys.stdout
+    if args.program or args.functions > 1:
+        out.write("(:f0\n")
+        for f in range(args.functions):
+            out.write("\n".join(Function("f%d" % f, args, rng).generate()) + "\n")
+        out.write(")\n")
+    else:
+        lines = Function("f0", args, rng).generate()
+        out.write("\n".join(l[2:] for l in lines) + "\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,39 @@
+#!/bin/bash
+#
+# Runs ./bin/L2 on one generated function of INSTRUCTIONS instructions with
+# each engine in ENGINES, on the default 8 MB stack, and fails unless every
+# run completes with a peak RSS of at most LIMIT kB.
+#
+# Usage: scripts/stress.sh [INSTRUCTIONS] [LIMIT] [ENGINES]
+#
+# The set engine keeps four string sets per instruction, so make stress runs
+# it separately on 100k instructions with its own limit.
+
+instructions=${1:-1000000} ;
+limit=${2:-262144} ;
+engines=${3:-"bitvector interval"} ;
+
+input=`mktemp /tmp/stress.XXXXXX.L2f` ;
+stats=`mktemp /tmp/stress.XXXXXX.stats` ;
+trap "rm -f $input $stats" EXIT ;
+
+./scripts/gen_L2.py -n $instructions > $input ;
+ulimit -s 8192 ;
+
+failed=0 ;
+for engine in $engines ; do
+  ./bin/L2 -s -e $engine $input 2>$stats >/dev/null ;
+  status=$? ;
+  rss=`grep "^peak RSS" $stats | cut -d' ' -f3` ;
+  if test $status -ne 0 ; then
+    echo "$engine: Failed (exit status $status)" ;
+    let failed=$failed+1 ;
+  elif test $rss -gt $limit ; then
+    echo "$engine: Failed (peak RSS $rss kB > $limit kB)" ;
+    let failed=$failed+1 ;
+  else
+    echo "$engine: Passed (peak RSS $rss kB)" ;
+  fi
+done
+
+test $failed -eq 0
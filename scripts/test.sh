@@ -2,20 +2,50 @@
 
 passed=0 ;
 failed=0 ;
-cd tests/liveness ; 
-for i in *.L2f ; do
+
+# tests/liveness holds liveness results, tests/reaching reaching definitions.
+# The liveness results are checked against every engine listed in engines
+# besides the default one: they must all print the same sets. The ranges
+# pass checks the live ranges printed by -r against the .ranges files.
+for dir in liveness reaching ; do
+engines="default" ;
+if test "${dir}" = "liveness" ; then
+  engines="default set hybrid interval forest query incremental ranges" ;
+fi
+cd tests/${dir} ;
+for engine in $engines ; do
+for i in *.L2f *.L2 ; do
+
+  golden=${i}.out ;
+  if test "${engine}" = "ranges" ; then
+    golden=${i}.ranges ;
+  fi
 
   # If the output already exists, skip the current test
-  if ! test -f ${i}.out ; then
+  if ! test -f ${golden} ; then
     continue ;
   fi
-  echo $i ;
+
+  # Whole programs (.L2) are parsed in program mode
+  flags="" ;
+  if test "${i##*.}" = "L2" ; then
+    flags="-p" ;
+  fi
+  if test "${dir}" = "reaching" ; then
+    flags="$flags -d" ;
+  fi
+  if test "${engine}" = "ranges" ; then
+    flags="$flags -r" ;
+  elif test "${engine}" != "default" ; then
+    flags="$flags -e ${engine}" ;
+  fi
+  echo ${dir}/$i $flags ;
 
   # Generate the binary
   pushd ./ ;
   cd ../../ ;
-  ./liveness tests/liveness/${i} &> tests/liveness/${i}.out.tmp ;
-  cmp tests/liveness/${i}.out.tmp tests/liveness/${i}.out ;
+  ./liveness $flags tests/${dir}/${i} &> tests/${dir}/${i}.out.tmp ;
+  cmp tests/${dir}/${i}.out.tmp tests/${dir}/${golden} ;
   if ! test $? -eq 0 ; then
     echo "  Failed" ;
     let failed=$failed+1 ;
@@ -23,7 +53,65 @@ for i in *.L2f ; do
     echo "  Passed" ;
     let passed=$passed+1 ;
   fi
-  popd ; 
+  popd ;
+done
+done
+cd ../../ ;
+done
+# Solver visits that change nothing must not allocate: under -s,
+# bin/L2-heapcheck reports the heap allocations they made, counted by its
+# replacement operator new.
+for engine in set bitvector hybrid interval reaching ; do
+  flags="-e $engine" ;
+  if test "${engine}" = "reaching" ; then
+    flags="-d" ;
+  fi
+  echo "allocations -e ${engine}" ;
+  counts=`for i in tests/liveness/*.L2f ; do ./bin/L2-heapcheck -s $flags $i 2>&1 >/dev/null ; done | sed -n "s/^  \([0-9]*\) heap allocations in visits that changed nothing$/\1/p" | sort -u` ;
+  if test "${counts}" = "0" ; then
+    echo "  Passed" ;
+    let passed=$passed+1 ;
+  else
+    echo "  Failed" ;
+    let failed=$failed+1 ;
+  fi
+done
+# A failed write must fail the run: output to a full device exits non-zero.
+echo "write error" ;
+if ./bin/L2 tests/liveness/test1.L2f > /dev/full 2>/dev/null ; then
+  echo "  Failed" ;
+  let failed=$failed+1 ;
+else
+  echo "  Passed" ;
+  let passed=$passed+1 ;
+fi
+# Input the grammar stops matching part way through is an error, not a
+# shorter function or a crash: the run exits 1. A compare takes exactly two
+# operands.
+input=`mktemp /tmp/test.XXXXXX.L2f` ;
+for ins in "(rax <- <- 2)" "(x <- a < b < c)" "(x <- a < b < c < d)" ; do
+  echo "syntax error $ins" ;
+  printf "(:f\n  0 0\n  (rax <- 1)\n  $ins\n  (return)\n)\n" > $input ;
+  ./bin/L2 $input > /dev/null 2>&1 ;
+  if test $? -eq 1 ; then
+    echo "  Passed" ;
+    let passed=$passed+1 ;
+  else
+    echo "  Failed" ;
+    let failed=$failed+1 ;
+  fi
+done
+rm -f $input ;
+# An engine only applies to liveness: -e with -r or -d is a usage error.
+for flags in "-r -e hybrid" "-d -e set" ; do
+  echo "usage error $flags" ;
+  if ./bin/L2 $flags tests/liveness/test1.L2f > /dev/null 2>&1 ; then
+    echo "  Failed" ;
+    let failed=$failed+1 ;
+  else
+    echo "  Passed" ;
+    let passed=$passed+1 ;
+  fi
 done
 let total=$passed+$failed ;
 
@@ -1,4 +1,7 @@
 // by: Zhiping
+
+#pragma once
+
 #include <string>
 #include <vector>
 #include <utility>
@@ -12,7 +15,10 @@
 #include <assert.h>
 #include <sstream>
 #include <iostream>
-#include <vector>
+#include <unordered_map>
+#include <memory>
+
+#include <arena.h>
 
 namespace L2 {
 
@@ -40,31 +46,235 @@ namespace L2 {
   // const int INS_CJUMP = 8;
   // const int INS_STACK = 9;
 
-  struct L2_item {
-    std::string labelName;
+  // Operators, as written in the source.
+  enum OP {
+    NO_OP, MOVE /* <- */, ADD /* += */, SUB /* -= */, MUL /* *= */, AND /* &= */,
+    SHL /* <<= */, SHR /* >>= */, INC /* ++ */, DEC /* -- */,
+    LESS /* < */, LESS_EQUAL /* <= */, EQUAL /* = */
   };
 
+  // An operand is a 32-bit handle: the low 3 bits are a tag, the rest is a
+  // symbol id (registers, variables, labels), an immediate, or an index.
+  //
+  // Immediates that do not fit the 29-bit payload live in the function's
+  // numbers pool. Label operands of goto/cjump are rewritten by the linker
+  // to TARGET handles holding the index of the labelled instruction.
   struct Item {
-    int type;         // defined by L1::ITEM_*TYPE*
-    std::string name; // for register & label
-    int value;        // for register (offset) & number
+    enum TAG {
+      REGISTER_TAG, LABEL_TAG, NUMBER_TAG, VAR_TAG, TARGET_TAG, POOLED_NUMBER_TAG
+    };
+
+    uint32_t bits;
+
+    static const int TAG_BITS = 3;
+    static const int32_t MAX_IMMEDIATE = (1 << (31 - TAG_BITS)) - 1;
+    static const int32_t MIN_IMMEDIATE = -MAX_IMMEDIATE - 1;
+
+    static Item make(int tag, uint32_t payload) {
+      Item i;
+      i.bits = (payload << TAG_BITS) | tag;
+      return i;
+    }
+
+    int tag() const {
+      return bits & ((1 << TAG_BITS) - 1);
+    }
+
+    // defined by L2::ITEM
+    int type() const {
+      switch (tag()) {
+        case TARGET_TAG: return ITEM::LABEL;
+        case POOLED_NUMBER_TAG: return ITEM::NUMBER;
+        default: return tag();
+      }
+    }
+
+    uint32_t payload() const {
+      return bits >> TAG_BITS;
+    }
+
+    int32_t immediate() const {
+      return (int32_t)bits >> TAG_BITS;
+    }
   };
 
   struct Instruction {
-    int type;     // defined by L1::INS_*TYPE*
-    std::vector<L2::Item *> items;
-    std::string op;
+    uint8_t type;  // defined by L2::INS
+    uint8_t op;    // defined by L2::OP
+    uint8_t size;  // number of items in use
+    Item items[4];
+
+    void push(Item i) {
+      assert(size < 4);
+      items[size++] = i;
+    }
+  };
+
+  // Symbols every table starts with, at fixed ids: the 16 registers sorted
+  // by name, then the runtime functions. rsp and the runtime functions are
+  // never live, and they are adjacent so that is one range check.
+  enum SYMBOL {
+    R10, R11, R12, R13, R14, R15, R8, R9, RAX, RBP, RBX, RCX, RDI, RDX, RSI, RSP,
+    PRINT, ALLOCATE, ARRAY_ERROR,
+    FIRST_USER_SYMBOL
   };
 
+  inline bool is_register(uint32_t sym) {
+    return sym <= SYMBOL::RSP;
+  }
+
+  inline bool is_never_live(uint32_t sym) {
+    return sym >= SYMBOL::RSP && sym <= SYMBOL::ARRAY_ERROR;
+  }
+
+  // Whether operand i holds a value liveness tracks.
+  inline bool is_live_item(Item i) {
+    return (i.type() == ITEM::REGISTER || i.type() == ITEM::VAR) && !is_never_live(i.payload());
+  }
+
+  // What one instruction reads and writes, recorded by the parser action
+  // that built it: bit t of reads / writes stands for items[t], set only
+  // when that operand holds a live value, and gen / kill are the registers
+  // the calling convention makes it read / write (masks as in registers.h).
+  struct UseDef {
+    uint8_t reads;
+    uint8_t writes;
+    uint16_t gen;
+    uint16_t kill;
+  };
+
+  constexpr uint8_t item_bit(int t) {
+    return (uint8_t)(1 << t);
+  }
+
+  // A name, kept in the program arena.
+  typedef std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>> Name;
+
+  // Interned names of a program: every register, variable and label is
+  // stored once, in the arena, and referred to by its id.
+  //
+  // The ids are found through an open-addressing table of id + 1 (0 for an
+  // empty slot) kept at most half full, so a name is looked up straight
+  // from the input characters and one seen before costs no allocation.
+  struct Symbols {
+    explicit Symbols(Arena * arena) : names(ArenaAllocator<Name>(arena)), slots(64, 0, ArenaAllocator<uint32_t>(arena)) {
+      static const char * const seeded[FIRST_USER_SYMBOL] = {
+        "r10", "r11", "r12", "r13", "r14", "r15", "r8", "r9",
+        "rax", "rbp", "rbx", "rcx", "rdi", "rdx", "rsi", "rsp",
+        "print", "allocate", "array-error"
+      };
+      for (auto name : seeded) {
+        intern(name, name + std::strlen(name));
+      }
+    }
+
+    // The id of the name in [begin, end), given the next one if it is new.
+    uint32_t intern(const char * begin, const char * end) {
+      std::size_t s = slot_of(begin, end - begin);
+      if (slots[s] != 0) {
+        return slots[s] - 1;
+      }
+      uint32_t id = names.size();
+      names.emplace_back(begin, end, names.get_allocator());
+      slots[s] = id + 1;
+      if (2 * names.size() > slots.size()) {
+        rehash();
+      }
+      return id;
+    }
+
+    uint32_t intern(const std::string & name) {
+      return intern(name.data(), name.data() + name.size());
+    }
+
+    // The id of a name interned before.
+    uint32_t id(const std::string & name) const {
+      std::size_t s = slot_of(name.data(), name.size());
+      assert(slots[s] != 0);
+      return slots[s] - 1;
+    }
+
+    const Name & name(uint32_t id) const {
+      return names[id];
+    }
+
+  private:
+    // The slot holding the name, or the empty one it would go in.
+    std::size_t slot_of(const char * name, std::size_t size) const {
+      uint32_t h = 2166136261u;  // FNV-1a
+      for (std::size_t c = 0; c < size; c++) {
+        h = (h ^ (unsigned char)name[c]) * 16777619u;
+      }
+      std::size_t mask = slots.size() - 1;
+      for (std::size_t s = h & mask; ; s = (s + 1) & mask) {
+        if (slots[s] == 0 || (names[slots[s] - 1].size() == size && std::memcmp(names[slots[s] - 1].data(), name, size) == 0)) {
+          return s;
+        }
+      }
+    }
+
+    void rehash() {
+      slots.assign(2 * slots.size(), 0);
+      for (uint32_t id = 0; id < names.size(); id++) {
+        slots[slot_of(names[id].data(), names[id].size())] = id + 1;
+      }
+    }
+
+    std::vector<Name, ArenaAllocator<Name>> names;
+    std::vector<uint32_t, ArenaAllocator<uint32_t>> slots;
+  };
+
+  // A function. Its name and rows live in the program arena; the parser
+  // fills them in one piece once the function is complete.
   struct Function {
-    std::string name;
-    int64_t arguments;
-    int64_t locals;
-    std::vector<L2::Instruction *> instructions;
+    Name name;
+    int64_t arguments = 0;
+    int64_t locals = 0;
+    std::vector<L2::Instruction, ArenaAllocator<L2::Instruction>> instructions;
+    std::vector<UseDef, ArenaAllocator<UseDef>> useDefs;   // instruction -> what it reads and writes
+    std::vector<int64_t, ArenaAllocator<int64_t>> numbers; // immediates too wide for an Item
+    const Symbols *symbols = nullptr;
+
+    explicit Function(Arena * arena) :
+      name(ArenaAllocator<char>(arena)),
+      instructions(ArenaAllocator<L2::Instruction>(arena)),
+      useDefs(ArenaAllocator<UseDef>(arena)),
+      numbers(ArenaAllocator<int64_t>(arena)) {}
+
+    // Name of a register, variable or label operand.
+    const Name & name_of(Item i) const {
+      if (i.tag() == Item::TARGET_TAG) {
+        return symbols->name(instructions[i.payload()].items[0].payload());
+      }
+      return symbols->name(i.payload());
+    }
+
+    int64_t value_of(Item i) const {
+      if (i.tag() == Item::POOLED_NUMBER_TAG) {
+        return numbers[i.payload()];
+      }
+      return i.immediate();
+    }
+
+    // Index of the instruction a goto/cjump label operand jumps to.
+    int target_of(Item i) const {
+      return i.payload();
+    }
   };
 
   struct Program {
-    std::string entryPointLabel;
-    std::vector<L2::Function *> functions;
+    // Owns the whole IR: every Function and its rows, the function list
+    // and the symbol table. It is held by pointer so the containers
+    // allocating from it stay valid when the program is moved.
+    std::unique_ptr<Arena> arena;
+    Name entryPointLabel;
+    std::vector<L2::Function *, ArenaAllocator<L2::Function *>> functions;
+    Symbols *symbols;  // lives in the arena, so functions can point at it
+
+    Program() :
+      arena(new Arena()),
+      entryPointLabel(ArenaAllocator<char>(arena.get())),
+      functions(ArenaAllocator<L2::Function *>(arena.get())),
+      symbols(arena->make<Symbols>(arena.get())) {}
   };
 }
@@ -0,0 +1,201 @@
+// by: Zhiping
+
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <initializer_list>
+
+namespace L2 {
+
+  // Bump-pointer arena owning the IR of one program.
+  //
+  // Objects are carved out of large chunks one after another and are never
+  // freed individually; release() (or the destructor) runs the destructors
+  // of the non-trivially destructible objects, newest first, and frees every
+  // chunk at once.
+  class Arena {
+  public:
+    Arena() {}
+
+    Arena(Arena && other) {
+      steal(other);
+    }
+
+    Arena & operator=(Arena && other) {
+      if (this != &other) {
+        release();
+        steal(other);
+      }
+      return *this;
+    }
+
+    Arena(const Arena &) = delete;
+    Arena & operator=(const Arena &) = delete;
+
+    ~Arena() {
+      release();
+    }
+
+    void * allocate(std::size_t size, std::size_t align) {
+      if (size > MAX_CHUNK / 4) {
+        return allocate_large(size, align);
+      }
+      std::size_t pad = (align - (std::size_t)cur % align) % align;
+      if (cur == nullptr || pad + size > (std::size_t)(end - cur)) {
+        grow(size + align);
+        pad = (align - (std::size_t)cur % align) % align;
+      }
+      char *p = cur + pad;
+      cur = p + size;
+      return p;
+    }
+
+    template< typename T, typename ... Args >
+    T * make(Args && ... args) {
+      T *object = new (allocate(sizeof(T), alignof(T))) T(std::forward< Args >(args) ...);
+      if (!std::is_trivially_destructible< T >::value) {
+        Destructor *d = new (allocate(sizeof(Destructor), alignof(Destructor))) Destructor();
+        d->destroy = &destroy< T >;
+        d->object = object;
+        d->next = dtors;
+        dtors = d;
+      }
+      return object;
+    }
+
+    void release() {
+      for (Destructor *d = dtors; d; d = d->next) {
+        d->destroy(d->object);
+      }
+      for (Chunk **list : {&chunks, &large}) {
+        while (*list) {
+          Chunk *next = (*list)->next;
+          std::free(*list);
+          *list = next;
+        }
+      }
+      dtors = nullptr;
+      cur = end = nullptr;
+      reserved = 0;
+    }
+
+    // Bytes reserved from the system so far.
+    std::size_t size() const {
+      return reserved;
+    }
+
+  private:
+    static const std::size_t FIRST_CHUNK = 64 * 1024;
+    static const std::size_t MAX_CHUNK = 4 * 1024 * 1024;
+
+    struct Chunk {
+      Chunk *next;
+    };
+
+    struct Destructor {
+      void (*destroy)(void *);
+      void *object;
+      Destructor *next;
+    };
+
+    template< typename T >
+    static void destroy(void *object) {
+      static_cast< T * >(object)->~T();
+    }
+
+    // Chunks double in size up to MAX_CHUNK. An object of more than a
+    // quarter of that gets a chunk of its own, kept apart, so the chunk being
+    // filled is not abandoned with room left in it.
+    void * allocate_large(std::size_t size, std::size_t align) {
+      Chunk *c = static_cast< Chunk * >(std::malloc(sizeof(Chunk) + size + align));
+      if (c == nullptr) {
+        throw std::bad_alloc();
+      }
+      c->next = large;
+      large = c;
+      reserved += sizeof(Chunk) + size + align;
+      char *p = (char *)(c + 1);
+      return p + (align - (std::size_t)p % align) % align;
+    }
+
+    void grow(std::size_t atLeast) {
+      std::size_t size = chunks ? 2 * (std::size_t)(end - (char *)(chunks + 1)) : FIRST_CHUNK;
+      if (size > MAX_CHUNK) {
+        size = MAX_CHUNK;
+      }
+      if (size < atLeast) {
+        size = atLeast;
+      }
+      Chunk *c = static_cast< Chunk * >(std::malloc(sizeof(Chunk) + size));
+      if (c == nullptr) {
+        throw std::bad_alloc();
+      }
+      c->next = chunks;
+      chunks = c;
+      cur = (char *)(c + 1);
+      end = cur + size;
+      reserved += sizeof(Chunk) + size;
+    }
+
+    void steal(Arena & other) {
+      chunks = other.chunks;
+      large = other.large;
+      dtors = other.dtors;
+      cur = other.cur;
+      end = other.end;
+      reserved = other.reserved;
+      other.chunks = nullptr;
+      other.large = nullptr;
+      other.dtors = nullptr;
+      other.cur = other.end = nullptr;
+      other.reserved = 0;
+    }
+
+    Chunk *chunks = nullptr;
+    Chunk *large = nullptr;
+    Destructor *dtors = nullptr;
+    char *cur = nullptr;
+    char *end = nullptr;
+    std::size_t reserved = 0;
+  };
+
+  // Allocator handing out arena memory, so standard containers can keep
+  // their elements in the arena too. Freeing does nothing: the memory comes
+  // back when the arena is released, so a container that grows leaves its
+  // old buffers behind and is best sized once. The arena goes with the
+  // container on assignment and swap.
+  template< typename T >
+  struct ArenaAllocator {
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    Arena *arena;
+
+    explicit ArenaAllocator(Arena * arena) : arena(arena) {}
+
+    template< typename U >
+    ArenaAllocator(const ArenaAllocator< U > & other) : arena(other.arena) {}
+
+    T * allocate(std::size_t n) {
+      return static_cast< T * >(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *, std::size_t) {}
+  };
+
+  template< typename T, typename U >
+  bool operator==(const ArenaAllocator< T > & a, const ArenaAllocator< U > & b) {
+    return a.arena == b.arena;
+  }
+
+  template< typename T, typename U >
+  bool operator!=(const ArenaAllocator< T > & a, const ArenaAllocator< U > & b) {
+    return a.arena != b.arena;
+  }
+}
@@ -0,0 +1,341 @@
+// by: Zhiping
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define L2_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+#include <bitvector.h>
+
+namespace L2 {
+
+  // Every variant is compiled for its own instruction set with a target
+  // attribute, so the build needs no -m flags and the binary still runs on
+  // any x86-64; the CPU is only asked which ones it can run. Other hosts
+  // only get the scalar variant.
+
+  /*
+   * Scalar
+   */
+
+  static void scalar_unite(word_t *s, const word_t *t, int words) {
+    for (int w = 0; w < words; w++) {
+      s[w] |= t[w];
+    }
+  }
+
+  static bool scalar_unite_changed(word_t *s, const word_t *t, int words) {
+    word_t grew = 0;
+    for (int w = 0; w < words; w++) {
+      grew |= t[w] & ~s[w];
+      s[w] |= t[w];
+    }
+    return grew != 0;
+  }
+
+  // Words w and up of unite_n, one at a time.
+  static bool unite_n_tail(word_t *s, const word_t * const *rows, int count, int w, int words) {
+    word_t grew = 0;
+    for (; w < words; w++) {
+      word_t x = s[w];
+      for (int r = 0; r < count; r++) {
+        x |= rows[r][w];
+      }
+      grew |= x ^ s[w];
+      s[w] = x;
+    }
+    return grew != 0;
+  }
+
+  static bool scalar_unite_n(word_t *s, const word_t * const *rows, int count, int words) {
+    return unite_n_tail(s, rows, count, 0, words);
+  }
+
+  static void scalar_transfer(word_t *s, const word_t *gen, const word_t *out, const word_t *kill, int words) {
+    for (int w = 0; w < words; w++) {
+      s[w] = gen[w] | (out[w] & ~kill[w]);
+    }
+  }
+
+  static bool scalar_transfer_changed(word_t *s, const word_t *gen, const word_t *out, const word_t *kill, int words) {
+    word_t diff = 0;
+    for (int w = 0; w < words; w++) {
+      word_t x = gen[w] | (out[w] & ~kill[w]);
+      diff |= x ^ s[w];
+      s[w] = x;
+    }
+    return diff != 0;
+  }
+
+#ifdef L2_X86_KERNELS
+  /*
+   * SSE2: 2 words at a time
+   */
+
+  static void sse2_unite(word_t *s, const word_t *t, int words) {
+    int w = 0;
+    for (; w + 2 <= words; w += 2) {
+      __m128i x = _mm_loadu_si128((const __m128i *)(s + w));
+      _mm_storeu_si128((__m128i *)(s + w), _mm_or_si128(x, _mm_loadu_si128((const __m128i *)(t + w))));
+    }
+    scalar_unite(s + w, t + w, words - w);
+  }
+
+  static bool sse2_unite_changed(word_t *s, const word_t *t, int words) {
+    __m128i grew = _mm_setzero_si128();
+    int w = 0;
+    for (; w + 2 <= words; w += 2) {
+      __m128i x = _mm_loadu_si128((const __m128i *)(s + w)), y = _mm_loadu_si128((const __m128i *)(t + w));
+      grew = _mm_or_si128(grew, _mm_andnot_si128(x, y));
+      _mm_storeu_si128((__m128i *)(s + w), _mm_or_si128(x, y));
+    }
+    bool changed = _mm_movemask_epi8(_mm_cmpeq_epi8(grew, _mm_setzero_si128())) != 0xFFFF;
+    return scalar_unite_changed(s + w, t + w, words - w) || changed;
+  }
+
+  static bool sse2_unite_n(word_t *s, const word_t * const *rows, int count, int words) {
+    __m128i grew = _mm_setzero_si128();
+    int w = 0;
+    for (; w + 2 <= words; w += 2) {
+      __m128i old = _mm_loadu_si128((const __m128i *)(s + w)), x = old;
+      for (int r = 0; r < count; r++) {
+        x = _mm_or_si128(x, _mm_loadu_si128((const __m128i *)(rows[r] + w)));
+      }
+      grew = _mm_or_si128(grew, _mm_xor_si128(x, old));
+      _mm_storeu_si128((__m128i *)(s + w), x);
+    }
+    bool changed = _mm_movemask_epi8(_mm_cmpeq_epi8(grew, _mm_setzero_si128())) != 0xFFFF;
+    return unite_n_tail(s, rows, count, w, words) || changed;
+  }
+
+  static inline __m128i sse2_step(const word_t *gen, const word_t *out, const word_t *kill, int w) {
+    __m128i o = _mm_loadu_si128((const __m128i *)(out + w));
+    __m128i k = _mm_loadu_si128((const __m128i *)(kill + w));
+    return _mm_or_si128(_mm_loadu_si128((const __m128i *)(gen + w)), _mm_andnot_si128(k, o));
+  }
+
+  static void sse2_transfer(word_t *s, const word_t *gen, const word_t *out, const word_t *kill, int words) {
+    int w = 0;
+    for (; w + 2 <= words; w += 2) {
+      _mm_storeu_si128((__m128i *)(s + w), sse2_step(gen, out, kill, w));
+    }
+    scalar_transfer(s + w, gen + w, out + w, kill + w, words - w);
+  }
+
+  static bool sse2_transfer_changed(word_t *s, const word_t *gen, const word_t *out, const word_t *kill, int words) {
+    __m128i diff = _mm_setzero_si128();
+    int w = 0;
+    for (; w + 2 <= words; w += 2) {
+      __m128i x = sse2_step(gen, out, kill, w);
+      diff = _mm_or_si128(diff, _mm_xor_si128(x, _mm_loadu_si128((const __m128i *)(s + w))));
+      _mm_storeu_si128((__m128i *)(s + w), x);
+    }
+    bool changed = _mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) != 0xFFFF;
+    return scalar_transfer_changed(s + w, gen + w, out + w, kill + w, words - w) || changed;
+  }
+
+  /*
+   * AVX2: 4 words at a time
+   */
+
+  __attribute__((target("avx2")))
+  static void avx2_unite(word_t *s, const word_t *t, int words) {
+    int w = 0;
+    for (; w + 4 <= words; w += 4) {
+      __m256i x = _mm256_loadu_si256((const __m256i *)(s + w));
+      _mm256_storeu_si256((__m256i *)(s + w), _mm256_or_si256(x, _mm256_loadu_si256((const __m256i *)(t + w))));
+    }
+    scalar_unite(s + w, t + w, words - w);
+  }
+
+  __attribute__((target("avx2")))
+  static bool avx2_unite_changed(word_t *s, const word_t *t, int words) {
+    __m256i grew = _mm256_setzero_si256();
+    int w = 0;
+    for (; w + 4 <= words; w += 4) {
+      __m256i x = _mm256_loadu_si256((const __m256i *)(s + w)), y = _mm256_loadu_si256((const __m256i *)(t + w));
+      grew = _mm256_or_si256(grew, _mm256_andnot_si256(x, y));
+      _mm256_storeu_si256((__m256i *)(s + w), _mm256_or_si256(x, y));
+    }
+    bool changed = !_mm256_testz_si256(grew, grew);
+    return scalar_unite_changed(s + w, t + w, words - w) || changed;
+  }
+
+  __attribute__((target("avx2")))
+  static bool avx2_unite_n(word_t *s, const word_t * const *rows, int count, int words) {
+    __m256i grew = _mm256_setzero_si256();
+    int w = 0;
+    for (; w + 4 <= words; w += 4) {
+      __m256i old = _mm256_loadu_si256((const __m256i *)(s + w)), x = old;
+      for (int r = 0; r < count; r++) {
+        x = _mm256_or_si256(x, _mm256_loadu_si256((const __m256i *)(rows[r] + w)));
+      }
+      grew = _mm256_or_si256(grew, _mm256_xor_si256(x, old));
+      _mm256_storeu_si256((__m256i *)(s + w), x);
+    }
+    bool changed = !_mm256_testz_si256(grew, grew);
+    return unite_n_tail(s, rows, count, w, words) || changed;
+  }
+
+  __attribute__((target("avx2")))
+  static inline __m256i avx2_step(const word_t *gen, const word_t *out, const word_t *kill, int w) {
+    __m256i o = _mm256_loadu_si256((const __m256i *)(out + w));
+    __m256i k = _mm256_loadu_si256((const __m256i *)(kill + w));
+    return _mm256_or_si256(_mm256_loadu_si256((const __m256i *)(gen + w)), _mm256_andnot_si256(k, o));
+  }
+
+  __attribute__((target("avx2")))
+  static void avx2_transfer(word_t *s, const word_t *gen, const word_t *out, const word_t *kill, int words) {
+    int w = 0;
+    for (; w + 4 <= words; w += 4) {
+      _mm256_storeu_si256((__m256i *)(s + w), avx2_step(gen, out, kill, w));
+    }
+    scalar_transfer(s + w, gen + w, out + w, kill + w, words - w);
+  }
+
+  __attribute__((target("avx2")))
+  static bool avx2_transfer_changed(word_t *s, const word_t *gen, const word_t *out, const word_t *kill, int words) {
+    __m256i diff = _mm256_setzero_si256();
+    int w = 0;
+    for (; w + 4 <= words; w += 4) {
+      __m256i x = avx2_step(gen, out, kill, w);
+      diff = _mm256_or_si256(diff, _mm256_xor_si256(x, _mm256_loadu_si256((const __m256i *)(s + w))));
+      _mm256_storeu_si256((__m256i *)(s + w), x);
+    }
+    bool changed = !_mm256_testz_si256(diff, diff);
+    return scalar_transfer_changed(s + w, gen + w, out + w, kill + w, words - w) || changed;
+  }
+
+  /*
+   * AVX-512: 8 words at a time, the tail through a lane mask. The transfer
+   * is one ternary-logic instruction: 0xF4 is gen | (out & ~kill) over the
+   * operand truth tables 0xF0, 0xCC and 0xAA.
+   */
+
+  __attribute__((target("avx512f")))
+  static inline __mmask8 avx512_tail(int left) {
+    return left >= 8 ? 0xFF : (__mmask8)((1 << left) - 1);
+  }
+
+  __attribute__((target("avx512f")))
+  static void avx512_unite(word_t *s, const word_t *t, int words) {
+    for (int w = 0; w < words; w += 8) {
+      __mmask8 m = avx512_tail(words - w);
+      __m512i x = _mm512_maskz_loadu_epi64(m, s + w);
+      _mm512_mask_storeu_epi64(s + w, m, _mm512_or_si512(x, _mm512_maskz_loadu_epi64(m, t + w)));
+    }
+  }
+
+  __attribute__((target("avx512f")))
+  static bool avx512_unite_changed(word_t *s, const word_t *t, int words) {
+    __mmask8 grew = 0;
+    for (int w = 0; w < words; w += 8) {
+      __mmask8 m = avx512_tail(words - w);
+      __m512i x = _mm512_maskz_loadu_epi64(m, s + w), y = _mm512_maskz_loadu_epi64(m, t + w);
+      grew |= _mm512_mask_test_epi64_mask(m, _mm512_andnot_si512(x, y), _mm512_andnot_si512(x, y));
+      _mm512_mask_storeu_epi64(s + w, m, _mm512_or_si512(x, y));
+    }
+    return grew != 0;
+  }
+
+  __attribute__((target("avx512f")))
+  static bool avx512_unite_n(word_t *s, const word_t * const *rows, int count, int words) {
+    __m512i grew = _mm512_setzero_si512();
+    for (int w = 0; w < words; w += 8) {
+      __mmask8 m = avx512_tail(words - w);
+      __m512i old = _mm512_maskz_loadu_epi64(m, s + w), x = old;
+      for (int r = 0; r < count; r++) {
+        x = _mm512_or_si512(x, _mm512_maskz_loadu_epi64(m, rows[r] + w));
+      }
+      grew = _mm512_or_si512(grew, _mm512_xor_si512(x, old));
+      _mm512_mask_storeu_epi64(s + w, m, x);
+    }
+    return _mm512_test_epi64_mask(grew, grew) != 0;
+  }
+
+  __attribute__((target("avx512f")))
+  static inline __m512i avx512_step(const word_t *gen, const word_t *out, const word_t *kill, int w, __mmask8 m) {
+    return _mm512_ternarylogic_epi64(_mm512_maskz_loadu_epi64(m, gen + w), _mm512_maskz_loadu_epi64(m, out + w),
+                                     _mm512_maskz_loadu_epi64(m, kill + w), 0xF4);
+  }
+
+  __attribute__((target("avx512f")))
+  static void avx512_transfer(word_t *s, const word_t *gen, const word_t *out, const word_t *kill, int words) {
+    for (int w = 0; w < words; w += 8) {
+      __mmask8 m = avx512_tail(words - w);
+      _mm512_mask_storeu_epi64(s + w, m, avx512_step(gen, out, kill, w, m));
+    }
+  }
+
+  __attribute__((target("avx512f")))
+  static bool avx512_transfer_changed(word_t *s, const word_t *gen, const word_t *out, const word_t *kill, int words) {
+    __mmask8 changed = 0;
+    for (int w = 0; w < words; w += 8) {
+      __mmask8 m = avx512_tail(words - w);
+      __m512i x = avx512_step(gen, out, kill, w, m);
+      changed |= _mm512_mask_cmpneq_epi64_mask(m, x, _mm512_maskz_loadu_epi64(m, s + w));
+      _mm512_mask_storeu_epi64(s + w, m, x);
+    }
+    return changed != 0;
+  }
+
+#endif
+
+  /*
+   * Dispatch
+   */
+
+  static const BitKernels KERNELS[] = {
+#ifdef L2_X86_KERNELS
+    {"avx512", avx512_unite, avx512_unite_changed, avx512_unite_n, avx512_transfer, avx512_transfer_changed},
+    {"avx2", avx2_unite, avx2_unite_changed, avx2_unite_n, avx2_transfer, avx2_transfer_changed},
+    {"sse2", sse2_unite, sse2_unite_changed, sse2_unite_n, sse2_transfer, sse2_transfer_changed},
+#endif
+    {"scalar", scalar_unite, scalar_unite_changed, scalar_unite_n, scalar_transfer, scalar_transfer_changed}
+  };
+
+  static bool supported(const BitKernels & k) {
+#ifdef L2_X86_KERNELS
+    __builtin_cpu_init();
+    if (std::strcmp(k.name, "avx512") == 0) {
+      return __builtin_cpu_supports("avx512f");
+    }
+    if (std::strcmp(k.name, "avx2") == 0) {
+      return __builtin_cpu_supports("avx2");
+    }
+    if (std::strcmp(k.name, "sse2") == 0) {
+      return __builtin_cpu_supports("sse2"); // always on x86-64, not on i386
+    }
+#endif
+    return true;
+  }
+
+  std::vector<const BitKernels *> bv_supported_kernels() {
+    std::vector<const BitKernels *> r;
+    for (auto & k : KERNELS) {
+      if (supported(k)) {
+        r.push_back(&k);
+      }
+    }
+    return r;
+  }
+
+  // The widest variant the CPU runs, unless L2_KERNELS names another one
+  // it runs.
+  static const BitKernels *select_kernels() {
+    const char *name = std::getenv("L2_KERNELS");
+    std::vector<const BitKernels *> r = bv_supported_kernels();
+    for (auto k : r) {
+      if (name && std::strcmp(name, k->name) == 0) {
+        return k;
+      }
+    }
+    return r.front();
+  }
+
+  const BitKernels *bv_kernels = select_kernels();
+}
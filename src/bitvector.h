@@ -0,0 +1,148 @@
+// by: Zhiping
+
+#pragma once
+
+#include <stdint.h>
+#include <cstring>
+#include <vector>
+
+namespace L2 {
+
+  // A bit-vector is a run of `words` 64-bit words, bit i of the set lives in
+  // word i / 64. The engine keeps all of them in flat slabs, so these helpers
+  // only work on raw word pointers.
+  typedef uint64_t word_t;
+
+  const int WORD_BITS = 64;
+
+  // The loops over whole rows, in one variant per instruction set (see
+  // bitvector.cpp). bv_kernels is the widest one the CPU runs, picked at
+  // startup; the environment variable L2_KERNELS=scalar|sse2|avx2|avx512
+  // selects a narrower one.
+  struct BitKernels {
+    const char *name;
+    void (*unite)(word_t *s, const word_t *t, int words);
+    bool (*unite_changed)(word_t *s, const word_t *t, int words);
+    bool (*unite_n)(word_t *s, const word_t * const *rows, int count, int words);
+    void (*transfer)(word_t *s, const word_t *gen, const word_t *out, const word_t *kill, int words);
+    bool (*transfer_changed)(word_t *s, const word_t *gen, const word_t *out, const word_t *kill, int words);
+  };
+
+  extern const BitKernels *bv_kernels;
+
+  // Widest first.
+  std::vector<const BitKernels *> bv_supported_kernels();
+
+  // Rows shorter than this stay on inline scalar code: most functions have
+  // well under 256 values, and an indirect call costs more than the loop.
+  const int KERNEL_WORDS = 4;
+
+  inline int bv_words(int bits) {
+    return (bits + WORD_BITS - 1) / WORD_BITS;
+  }
+
+  inline void bv_set(word_t *s, int i) {
+    s[i / WORD_BITS] |= (word_t)1 << (i % WORD_BITS);
+  }
+
+  inline void bv_reset(word_t *s, int i) {
+    s[i / WORD_BITS] &= ~((word_t)1 << (i % WORD_BITS));
+  }
+
+  inline bool bv_test(const word_t *s, int i) {
+    return (s[i / WORD_BITS] >> (i % WORD_BITS)) & 1;
+  }
+
+  inline void bv_clear(word_t *s, int words) {
+    std::memset(s, 0, words * sizeof(word_t));
+  }
+
+  inline void bv_copy(word_t *s, const word_t *t, int words) {
+    std::memcpy(s, t, words * sizeof(word_t));
+  }
+
+  // memcmp already picks its own vector code at load time.
+  inline bool bv_equal(const word_t *s, const word_t *t, int words) {
+    return std::memcmp(s, t, words * sizeof(word_t)) == 0;
+  }
+
+  // s |= t
+  inline void bv_union(word_t *s, const word_t *t, int words) {
+    if (words >= KERNEL_WORDS) {
+      bv_kernels->unite(s, t, words);
+      return;
+    }
+    for (int w = 0; w < words; w++) {
+      s[w] |= t[w];
+    }
+  }
+
+  // s |= t, telling whether s grew.
+  inline bool bv_union_changed(word_t *s, const word_t *t, int words) {
+    if (words >= KERNEL_WORDS) {
+      return bv_kernels->unite_changed(s, t, words);
+    }
+    word_t grew = 0;
+    for (int w = 0; w < words; w++) {
+      grew |= t[w] & ~s[w];
+      s[w] |= t[w];
+    }
+    return grew != 0;
+  }
+
+  // s |= rows[0] | ... | rows[count - 1], storing s once and telling whether
+  // it grew.
+  inline bool bv_union_n(word_t *s, const word_t * const *rows, int count, int words) {
+    if (words >= KERNEL_WORDS) {
+      return bv_kernels->unite_n(s, rows, count, words);
+    }
+    word_t grew = 0;
+    for (int w = 0; w < words; w++) {
+      word_t x = s[w];
+      for (int r = 0; r < count; r++) {
+        x |= rows[r][w];
+      }
+      grew |= x ^ s[w];
+      s[w] = x;
+    }
+    return grew != 0;
+  }
+
+  // s = gen | (out & ~kill)
+  inline void bv_transfer(word_t *s, const word_t *gen, const word_t *out, const word_t *kill, int words) {
+    if (words >= KERNEL_WORDS) {
+      bv_kernels->transfer(s, gen, out, kill, words);
+      return;
+    }
+    for (int w = 0; w < words; w++) {
+      s[w] = gen[w] | (out[w] & ~kill[w]);
+    }
+  }
+
+  // s = gen | (out & ~kill), telling whether s changed.
+  inline bool bv_transfer_changed(word_t *s, const word_t *gen, const word_t *out, const word_t *kill, int words) {
+    if (words >= KERNEL_WORDS) {
+      return bv_kernels->transfer_changed(s, gen, out, kill, words);
+    }
+    word_t diff = 0;
+    for (int w = 0; w < words; w++) {
+      word_t x = gen[w] | (out[w] & ~kill[w]);
+      diff |= x ^ s[w];
+      s[w] = x;
+    }
+    return diff != 0;
+  }
+
+  // Calls f(i) for every bit i set in s, in increasing order.
+  template< typename F >
+  inline void bv_for_each(const word_t *s, int words, F f) {
+    for (int w = 0; w < words; w++) {
+      word_t bits = s[w];
+      while (bits) {
+        int b = __builtin_ctzll(bits);
+        f(w * WORD_BITS + b);
+        bits &= bits - 1;
+      }
+    }
+  }
+}
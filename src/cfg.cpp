@@ -0,0 +1,359 @@
+// by: Zhiping
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <cfg.h>
+
+namespace L2 {
+
+  // Fill next_indexs with the instruction indices control can reach after
+  // instruction k. Label operands were resolved to instruction indices by
+  // the parser.
+  void find_successors(std::vector<int> * next_indexs, L2::Function * func, int k) {
+    const L2::Instruction & cur_ins = func->instructions[k];
+
+    switch (cur_ins.type) {
+      case L2::INS::GOTO:
+            next_indexs->push_back(func->target_of(cur_ins.items[0]));
+            break;
+      case L2::INS::CJUMP:
+            if (cur_ins.items[0].type() == L2::ITEM::NUMBER && cur_ins.items[1].type() == L2::ITEM::NUMBER) {
+              int64_t left = func->value_of(cur_ins.items[0]), right = func->value_of(cur_ins.items[1]);
+              if ((cur_ins.op == L2::OP::LESS_EQUAL && left <= right)
+                || (cur_ins.op == L2::OP::LESS && left < right)
+                || (cur_ins.op == L2::OP::EQUAL && left == right)) {
+                  next_indexs->push_back(func->target_of(cur_ins.items[2]));
+              } else {
+                next_indexs->push_back(func->target_of(cur_ins.items[3]));
+              }
+            } else {
+              next_indexs->push_back(func->target_of(cur_ins.items[2]));
+              next_indexs->push_back(func->target_of(cur_ins.items[3]));
+            }
+            break;
+      case L2::INS::RETURN: // leaves the function
+            break;
+      default: // For normal situation
+            next_indexs->push_back(k+1);
+            break;
+    }
+  }
+
+  void build_cfg(CFG * cfg, L2::Function * func) {
+    int n = func->instructions.size();
+
+    // Mark the leaders, then number the blocks.
+    std::vector<bool> leader(n + 1, false);
+    leader[0] = true;
+    leader[n] = true;
+    for (int k = 0; k < n; k++) {
+      switch (func->instructions[k].type) {
+        case L2::INS::LABEL_INS:
+              leader[k] = true;
+              break;
+        case L2::INS::GOTO:
+        case L2::INS::CJUMP:
+        case L2::INS::RETURN:
+              leader[k + 1] = true;
+              break;
+        default:
+              break;
+      }
+    }
+    std::vector<int> blockOf(n + 1);
+    cfg->start.clear();
+    for (int k = 0; k <= n; k++) {
+      if (leader[k]) {
+        cfg->start.push_back(k);
+      }
+      blockOf[k] = cfg->start.size() - 1;
+    }
+    int B = cfg->size();
+
+    // Successors of a block are those of its last instruction; falling off
+    // the end of the function is not an edge.
+    cfg->succStart.assign(B + 1, 0);
+    cfg->succ.clear();
+    std::vector<int> next_indexs;
+    for (int b = 0; b < B; b++) {
+      next_indexs.clear();
+      find_successors(&next_indexs, func, cfg->start[b + 1] - 1);
+      for (int next_index : next_indexs) {
+        if (next_index < n) {
+          cfg->succ.push_back(blockOf[next_index]);
+        }
+      }
+      cfg->succStart[b + 1] = cfg->succ.size();
+    }
+
+    cfg->predStart.assign(B + 1, 0);
+    for (int s : cfg->succ) {
+      cfg->predStart[s + 1]++;
+    }
+    for (int b = 0; b < B; b++) {
+      cfg->predStart[b + 1] += cfg->predStart[b];
+    }
+    cfg->pred.resize(cfg->succ.size());
+    std::vector<int> fill(cfg->predStart.begin(), cfg->predStart.end() - 1);
+    for (int b = 0; b < B; b++) {
+      for (int e = cfg->succStart[b]; e < cfg->succStart[b + 1]; e++) {
+        cfg->pred[fill[cfg->succ[e]]++] = b;
+      }
+    }
+
+    build_sccs(cfg);
+  }
+
+  // Tarjan's algorithm, with an explicit call stack so that long chains of
+  // blocks cannot overflow the native one.
+  void build_sccs(CFG * cfg) {
+    int B = cfg->size();
+    std::vector<int> index(B, -1), low(B), edge(B);
+    std::vector<bool> onStack(B, false);
+    std::vector<int> stack, call;
+    int counter = 0;
+
+    cfg->sccStart.assign(1, 0);
+    cfg->sccBlock.clear();
+    cfg->sccOf.assign(B, -1);
+    cfg->cyclic.clear();
+
+    auto enter = [&](int b) {
+      index[b] = low[b] = counter++;
+      edge[b] = cfg->succStart[b];
+      stack.push_back(b);
+      onStack[b] = true;
+      call.push_back(b);
+    };
+    for (int root = 0; root < B; root++) {
+      if (index[root] >= 0) {
+        continue;
+      }
+      enter(root);
+      while (!call.empty()) {
+        int b = call.back();
+        if (edge[b] < cfg->succStart[b + 1]) {
+          int s = cfg->succ[edge[b]++];
+          if (index[s] < 0) {
+            enter(s);
+          } else if (onStack[s]) {
+            low[b] = std::min(low[b], index[s]);
+          }
+          continue;
+        }
+        call.pop_back();
+        if (!call.empty()) {
+          low[call.back()] = std::min(low[call.back()], low[b]);
+        }
+        if (low[b] != index[b]) {
+          continue;
+        }
+
+        // b is the root of a component: pop it off the stack.
+        int c = cfg->components();
+        int first = cfg->sccBlock.size();
+        int s;
+        do {
+          s = stack.back();
+          stack.pop_back();
+          onStack[s] = false;
+          cfg->sccOf[s] = c;
+          cfg->sccBlock.push_back(s);
+        } while (s != b);
+        std::sort(cfg->sccBlock.begin() + first, cfg->sccBlock.end());
+        cfg->sccStart.push_back(cfg->sccBlock.size());
+
+        bool cyclic = cfg->sccBlock.size() - first > 1;
+        for (int e = cfg->succStart[b]; e < cfg->succStart[b + 1]; e++) {
+          cyclic = cyclic || cfg->succ[e] == b;
+        }
+        cfg->cyclic.push_back(cyclic);
+      }
+    }
+  }
+
+  bool build_loop_forest(LoopForest * forest, const CFG & cfg) {
+    int B = cfg.size();
+
+    // Depth-first search from every root in turn; an edge into a block
+    // still on the stack is retreating.
+    std::vector<int> pre(B, -1), edge(B);
+    std::vector<bool> onStack(B, false);
+    std::vector<int> call;
+    std::vector<std::pair<int, int>> retreating; // (source, target)
+    std::vector<bool> root(B, false);
+    int counter = 0;
+    forest->post.clear();
+    for (int r = 0; r < B; r++) {
+      if (pre[r] >= 0) {
+        continue;
+      }
+      root[r] = true;
+      pre[r] = counter++;
+      edge[r] = cfg.succStart[r];
+      onStack[r] = true;
+      call.push_back(r);
+      while (!call.empty()) {
+        int b = call.back();
+        if (edge[b] < cfg.succStart[b + 1]) {
+          int s = cfg.succ[edge[b]++];
+          if (pre[s] < 0) {
+            pre[s] = counter++;
+            edge[s] = cfg.succStart[s];
+            onStack[s] = true;
+            call.push_back(s);
+          } else if (onStack[s]) {
+            retreating.push_back(std::make_pair(b, s));
+          }
+          continue;
+        }
+        call.pop_back();
+        onStack[b] = false;
+        forest->post.push_back(b);
+      }
+    }
+
+    // Immediate dominators (Cooper, Harvey and Kennedy) over reverse
+    // postorder, with a virtual entry B above all the roots.
+    std::vector<int> rpo(B + 1), idom(B + 1, -1);
+    for (int i = 0; i < B; i++) {
+      rpo[forest->post[i]] = B - i;
+    }
+    rpo[B] = 0;
+    idom[B] = B;
+    auto intersect = [&](int a, int b) {
+      while (a != b) {
+        while (rpo[a] > rpo[b]) {
+          a = idom[a];
+        }
+        while (rpo[b] > rpo[a]) {
+          b = idom[b];
+        }
+      }
+      return a;
+    };
+    for (bool changed = true; changed; ) {
+      changed = false;
+      for (int i = B - 1; i >= 0; i--) {
+        int b = forest->post[i];
+        int d = root[b] ? B : -1;
+        for (int e = cfg.predStart[b]; e < cfg.predStart[b + 1]; e++) {
+          int p = cfg.pred[e];
+          if (idom[p] >= 0) {
+            d = d < 0 ? p : intersect(d, p);
+          }
+        }
+        if (d != idom[b]) {
+          idom[b] = d;
+          changed = true;
+        }
+      }
+    }
+
+    // Number the dominator tree depth-first, so that h dominates b exactly
+    // when b's interval [in, out) lies within h's.
+    std::vector<int> childStart(B + 2, 0), child(B);
+    for (int b = 0; b < B; b++) {
+      childStart[idom[b] + 1]++;
+    }
+    for (int d = 0; d <= B; d++) {
+      childStart[d + 1] += childStart[d];
+    }
+    std::vector<int> fill(childStart.begin(), childStart.end() - 1);
+    for (int b = 0; b < B; b++) {
+      child[fill[idom[b]]++] = b;
+    }
+    std::vector<int> in(B + 1), out(B + 1);
+    counter = 0;
+    in[B] = counter++;
+    std::vector<int> next(B + 1);
+    next[B] = childStart[B];
+    call.assign(1, B);
+    while (!call.empty()) {
+      int d = call.back();
+      if (next[d] < childStart[d + 1]) {
+        int c = child[next[d]++];
+        in[c] = counter++;
+        next[c] = childStart[c];
+        call.push_back(c);
+        continue;
+      }
+      out[d] = counter;
+      call.pop_back();
+    }
+
+    // Every retreating edge must be a back edge: its target dominates its
+    // source. Group the back edges by header.
+    std::vector<std::vector<int>> latches(B);
+    for (auto & r : retreating) {
+      int b = r.first, h = r.second;
+      if (in[b] < in[h] || out[b] > out[h]) {
+        return false;
+      }
+      latches[h].push_back(b);
+    }
+
+    // Number the loops by header preorder, so outer before inner, then
+    // collect every body by a backward search from the latches that stops
+    // at the header. Going from inner to outer loops, the first loop to
+    // find an inner header is its parent.
+    std::vector<int> headers;
+    for (int b = 0; b < B; b++) {
+      if (!latches[b].empty()) {
+        headers.push_back(b);
+      }
+    }
+    std::sort(headers.begin(), headers.end(), [&](int a, int b) {
+      return pre[a] < pre[b];
+    });
+    int L = headers.size();
+    std::vector<int> loopOfHeader(B, -1);
+    for (int l = 0; l < L; l++) {
+      loopOfHeader[headers[l]] = l;
+    }
+    forest->header = headers;
+    forest->parent.assign(L, -1);
+
+    std::vector<std::vector<int>> blocks(L);
+    std::vector<int> mark(B, -1), work;
+    for (int l = L - 1; l >= 0; l--) {
+      int h = headers[l];
+      mark[h] = l;
+      blocks[l].push_back(h);
+      work = latches[h];
+      while (!work.empty()) {
+        int b = work.back();
+        work.pop_back();
+        if (mark[b] == l) {
+          continue;
+        }
+        mark[b] = l;
+        blocks[l].push_back(b);
+        if (loopOfHeader[b] >= 0 && forest->parent[loopOfHeader[b]] < 0) {
+          forest->parent[loopOfHeader[b]] = l;
+        }
+        for (int e = cfg.predStart[b]; e < cfg.predStart[b + 1]; e++) {
+          work.push_back(cfg.pred[e]);
+        }
+      }
+    }
+
+    std::vector<int> postIndex(B);
+    for (int i = 0; i < B; i++) {
+      postIndex[forest->post[i]] = i;
+    }
+    forest->loopStart.assign(1, 0);
+    forest->loopBlock.clear();
+    for (int l = 0; l < L; l++) {
+      std::sort(blocks[l].begin(), blocks[l].end(), [&](int a, int b) {
+        return postIndex[a] < postIndex[b];
+      });
+      forest->loopBlock.insert(forest->loopBlock.end(), blocks[l].begin(), blocks[l].end());
+      forest->loopStart.push_back(forest->loopBlock.size());
+      std::vector<int>().swap(blocks[l]);
+    }
+    return true;
+  }
+}
@@ -0,0 +1,66 @@
+// by: Zhiping
+
+#pragma once
+
+#include <L2.h>
+
+namespace L2 {
+
+  // Basic-block control flow graph of one function.
+  //
+  // A block starts at instruction 0, at every label and right after every
+  // goto, cjump and return; it ends at the next such point. Block b covers
+  // instructions [start[b], start[b + 1]). Edges are kept in CSR form: the
+  // successors of b are succ[succStart[b] .. succStart[b + 1]), the
+  // predecessors likewise in pred/predStart.
+  //
+  // The strongly connected components are listed in the order Tarjan's
+  // algorithm completes them, so a component comes after every component it
+  // reaches (reverse topological order). Component c holds the blocks
+  // sccBlock[sccStart[c] .. sccStart[c + 1]) in increasing order, sccOf[b]
+  // is the component of block b, and cyclic[c] tells whether c contains a
+  // cycle: more than one block, or a block that jumps to itself.
+  struct CFG {
+    std::vector<int> start;
+    std::vector<int> succStart, succ;
+    std::vector<int> predStart, pred;
+    std::vector<int> sccStart, sccBlock, sccOf;
+    std::vector<bool> cyclic;
+
+    int size() const {
+      return start.size() - 1;
+    }
+
+    int components() const {
+      return sccStart.size() - 1;
+    }
+  };
+
+  // Loop-nesting forest of a reducible CFG.
+  //
+  // The blocks are numbered by a depth-first search from block 0, then from
+  // every block it did not reach; post lists them in postorder. Loop l is
+  // the natural loop of header[l] (all its back edges merged), parent[l] is
+  // the loop directly around it or -1, and its blocks, in postorder, are
+  // loopBlock[loopStart[l] .. loopStart[l + 1]). Loops are numbered outer
+  // before inner.
+  struct LoopForest {
+    std::vector<int> post;
+    std::vector<int> header, parent;
+    std::vector<int> loopStart, loopBlock;
+
+    int loops() const {
+      return header.size();
+    }
+  };
+
+  void find_successors(std::vector<int> * next_indexs, L2::Function * func, int k);
+
+  void build_cfg(CFG * cfg, L2::Function * func);
+
+  void build_sccs(CFG * cfg);
+
+  // Returns false, leaving forest unspecified, when cfg is irreducible: some
+  // edge closes a cycle into a block that does not dominate its source.
+  bool build_loop_forest(LoopForest * forest, const CFG & cfg);
+}
@@ -0,0 +1,392 @@
+// by: Zhiping
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include <bitvector.h>
+#include <cfg.h>
+#include <heapcount.h>
+
+namespace L2 {
+
+  // Generic dataflow over a CFG, resolved at compile time.
+  //
+  // A problem is put together from:
+  //   - a DIRECTION;
+  //   - a lattice, which owns the storage of the values of a set of nodes
+  //     (a Store) and hands out Value / ConstValue handles to them with at();
+  //     it provides meet(s, t) (s = s meet t, telling whether s changed),
+  //     meet_n(s, values, count) (the same over count values at once),
+  //     equal, copy, unite (set union), transfer(s, gen, in, kill)
+  //     (s = gen U (in - kill)) and transfer_changed, the same telling
+  //     whether s changed;
+  //   - a transfer policy, called as t(lattice, s, in, node), which sets s to
+  //     the value after node given the value before it, both in the
+  //     direction of the flow; solve() calls its update(lattice, s, in,
+  //     node) instead, which does the same in place and tells whether s
+  //     changed.
+  //
+  // IN and OUT always mean the values at the entry and exit of a node in
+  // program order, whichever way the information flows.
+  enum DIRECTION {
+    FORWARD, BACKWARD
+  };
+
+  // Meet operator over bit-vector rows, for may problems.
+  struct Union {
+    static bool apply(word_t *s, const word_t *t, int words) {
+      return bv_union_changed(s, t, words);
+    }
+
+    static bool apply_n(word_t *s, const word_t * const *rows, int count, int words) {
+      return bv_union_n(s, rows, count, words);
+    }
+  };
+
+  // Bit-vector lattice: the values of n nodes are n rows of words words in
+  // one slab.
+  template< typename Meet = Union >
+  struct BitLattice {
+    typedef std::vector<word_t> Store;
+    typedef word_t *Value;
+    typedef const word_t *ConstValue;
+
+    int words;
+
+    explicit BitLattice(int words) : words(words) {}
+
+    Store make(int n) const {
+      return Store(n * words);
+    }
+
+    Value at(Store & s, int k) const {
+      return s.data() + k * words;
+    }
+
+    ConstValue at(const Store & s, int k) const {
+      return s.data() + k * words;
+    }
+
+    bool meet(Value s, ConstValue t) const {
+      return Meet::apply(s, t, words);
+    }
+
+    bool meet_n(Value s, const ConstValue *values, int count) const {
+      return Meet::apply_n(s, values, count, words);
+    }
+
+    bool equal(ConstValue s, ConstValue t) const {
+      return bv_equal(s, t, words);
+    }
+
+    void copy(Value s, ConstValue t) const {
+      bv_copy(s, t, words);
+    }
+
+    void unite(Value s, ConstValue t) const {
+      bv_union(s, t, words);
+    }
+
+    void transfer(Value s, ConstValue gen, ConstValue in, ConstValue kill) const {
+      bv_transfer(s, gen, in, kill, words);
+    }
+
+    bool transfer_changed(Value s, ConstValue gen, ConstValue in, ConstValue kill) const {
+      return bv_transfer_changed(s, gen, in, kill, words);
+    }
+  };
+
+  // Bit-vector lattice whose store holds a pointer to the row of every node
+  // instead of the rows themselves, so rows can be handed out from a RowPool
+  // and taken back while solving.
+  template< typename Meet = Union >
+  struct BitRowLattice : BitLattice< Meet > {
+    typedef std::vector<word_t *> Store;
+    typedef word_t *Value;
+    typedef const word_t *ConstValue;
+
+    explicit BitRowLattice(int words) : BitLattice< Meet >(words) {}
+
+    Store make(int n) const {
+      return Store(n, nullptr);
+    }
+
+    Value at(Store & s, int k) const {
+      return s[k];
+    }
+
+    ConstValue at(const Store & s, int k) const {
+      return s[k];
+    }
+  };
+
+  // Rows of words words, carved out of chunks that never move and taken
+  // back for reuse; a row is cleared when it is handed out.
+  class RowPool {
+  public:
+    explicit RowPool(int words) : words(words) {}
+
+    word_t * take() {
+      if (free.empty()) {
+        chunks.emplace_back(new word_t[CHUNK * words]);
+        for (int i = CHUNK - 1; i >= 0; i--) {
+          free.push_back(chunks.back().get() + i * words);
+        }
+      }
+      word_t *row = free.back();
+      free.pop_back();
+      bv_clear(row, words);
+      return row;
+    }
+
+    void give(word_t * row) {
+      free.push_back(row);
+    }
+
+    // Bytes of rows allocated, which is the most ever held at once.
+    std::size_t bytes() const {
+      return chunks.size() * CHUNK * words * sizeof(word_t);
+    }
+
+  private:
+    static const int CHUNK = 64;
+
+    int words;
+    std::vector<std::unique_ptr<word_t[]>> chunks;
+    std::vector<word_t *> free;
+  };
+
+  // Hooks solve() calls around every component c: enter(c) before its
+  // blocks are first visited, leave(c) once their values are final.
+  struct NoHooks {
+    void enter(int c) const {}
+    void leave(int c) const {}
+  };
+
+  template< typename Enter, typename Leave >
+  struct ComponentHooks {
+    Enter enter;
+    Leave leave;
+  };
+
+  template< typename Enter, typename Leave >
+  ComponentHooks< Enter, Leave > component_hooks(Enter enter, Leave leave) {
+    return ComponentHooks< Enter, Leave >{enter, leave};
+  }
+
+  // Transfer policy of a gen/kill problem: node k maps in to
+  // GEN[k] U (in - KILL[k]).
+  template< typename Lattice >
+  struct GenKill {
+    const typename Lattice::Store & GEN;
+    const typename Lattice::Store & KILL;
+
+    void operator()(const Lattice & l, typename Lattice::Value s, typename Lattice::ConstValue in, int k) const {
+      l.transfer(s, l.at(GEN, k), in, l.at(KILL, k));
+    }
+
+    bool update(const Lattice & l, typename Lattice::Value s, typename Lattice::ConstValue in, int k) const {
+      return l.transfer_changed(s, l.at(GEN, k), in, l.at(KILL, k));
+    }
+  };
+
+  // Folds the instruction GEN/KILL of every block into block summaries, by
+  // composing the instructions in the direction of the flow:
+  // GEN[b] = GEN[k] U (GEN[b] - KILL[k]), KILL[b] = KILL[b] U KILL[k].
+  // BGEN and BKILL start out empty.
+  template< DIRECTION D, typename Lattice >
+  void summarize(const CFG & cfg, const Lattice & l, const typename Lattice::Store & GEN, const typename Lattice::Store & KILL,
+                 typename Lattice::Store & BGEN, typename Lattice::Store & BKILL) {
+    for (int b = 0; b < cfg.size(); b++) {
+      typename Lattice::Value gen = l.at(BGEN, b), kill = l.at(BKILL, b);
+      for (int i = cfg.start[b]; i < cfg.start[b + 1]; i++) {
+        int k = D == BACKWARD ? cfg.start[b + 1] - 1 - (i - cfg.start[b]) : i;
+        l.transfer(gen, l.at(GEN, k), gen, l.at(KILL, k));
+        l.unite(kill, l.at(KILL, k));
+      }
+    }
+  }
+
+  // Solves the problem over the blocks of cfg to its fixpoint; t is the
+  // transfer of a whole block. BIN and BOUT hold one value per block and
+  // start out at the initial value.
+  //
+  // The strongly connected components are solved one after the other in the
+  // order of the flow, so every value flowing into a component is final by
+  // the time it is reached. A block outside any cycle is then visited
+  // exactly once; only a cyclic component iterates, on a FIFO ring of its
+  // own blocks holding each at most once, until none of them changes.
+  // visits[c] gets the number of block visits spent in component c.
+  //
+  // A visit updates OUT and IN (IN and OUT forward) in place, and learns
+  // from the updates themselves whether either changed, so it needs no
+  // scratch value and no comparison. In a build with L2_COUNT_HEAP,
+  // *allocations, if given, gets the heap allocations made by the visits
+  // that changed nothing, which the bit-vector lattice keeps at zero.
+  //
+  // The hooks see every component in and out (see NoHooks), so a caller
+  // can hold values for just the blocks that still need them.
+  template< DIRECTION D, typename Lattice, typename Transfer, typename Hooks = NoHooks >
+  void solve(const CFG & cfg, const Lattice & l, const Transfer & t,
+             typename Lattice::Store & BIN, typename Lattice::Store & BOUT, std::vector<int64_t> *visits,
+             int64_t *allocations = nullptr, const Hooks & hooks = Hooks()) {
+    int C = cfg.components();
+    typename Lattice::Store & head = D == BACKWARD ? BOUT : BIN;
+    typename Lattice::Store & tail = D == BACKWARD ? BIN : BOUT;
+    const std::vector<int> & from = D == BACKWARD ? cfg.succ : cfg.pred;
+    const std::vector<int> & fromStart = D == BACKWARD ? cfg.succStart : cfg.predStart;
+    const std::vector<int> & to = D == BACKWARD ? cfg.pred : cfg.succ;
+    const std::vector<int> & toStart = D == BACKWARD ? cfg.predStart : cfg.succStart;
+
+    // OUT[b] (IN[b] forward) meets the neighbours' values in one pass over
+    // it; returns whether it changed.
+    int fanIn = 0;
+    for (int b = 0; b < cfg.size(); b++) {
+      fanIn = std::max(fanIn, fromStart[b + 1] - fromStart[b]);
+    }
+    std::vector<typename Lattice::ConstValue> values(fanIn);
+    auto gather = [&](int b) {
+      int count = 0;
+      for (int e = fromStart[b]; e < fromStart[b + 1]; e++) {
+        values[count++] = l.at(tail, from[e]);
+      }
+      return l.meet_n(l.at(head, b), values.data(), count);
+    };
+
+    // The ring of the largest component serves them all.
+    int largest = 0;
+    for (int c = 0; c < C; c++) {
+      largest = std::max(largest, cfg.sccStart[c + 1] - cfg.sccStart[c]);
+    }
+    std::vector<int> worklist(largest);
+    std::vector<bool> queued(cfg.size(), false);
+    visits->assign(C, 0);
+#ifdef L2_COUNT_HEAP
+    if (allocations) {
+      *allocations = 0;
+    }
+#endif
+    for (int i = 0; i < C; i++) {
+      // Tarjan lists the components sinks first, as a backward flow wants.
+      int c = D == BACKWARD ? i : C - 1 - i;
+      int first = cfg.sccStart[c], size = cfg.sccStart[c + 1] - first;
+      hooks.enter(c);
+      if (!cfg.cyclic[c]) {
+        int b = cfg.sccBlock[first];
+        gather(b);
+        t(l, l.at(tail, b), l.at(head, b), b);
+        (*visits)[c]++;
+        hooks.leave(c);
+        continue;
+      }
+
+      for (int k = 0; k < size; k++) {
+        int b = cfg.sccBlock[D == BACKWARD ? first + size - 1 - k : first + k];
+        worklist[k] = b;
+        queued[b] = true;
+      }
+      int front = 0, count = size;
+      while (count > 0) {
+        int b = worklist[front];
+        front = (front + 1) % size;
+        count--;
+        queued[b] = false;
+        (*visits)[c]++;
+
+#ifdef L2_COUNT_HEAP
+        int64_t before = heap_allocations();
+        bool gathered = gather(b);
+        if (!t.update(l, l.at(tail, b), l.at(head, b), b)) {
+          if (!gathered && allocations) {
+            *allocations += heap_allocations() - before;
+          }
+          continue;
+        }
+#else
+        gather(b);
+        if (!t.update(l, l.at(tail, b), l.at(head, b), b)) {
+          continue;
+        }
+#endif
+        for (int e = toStart[b]; e < toStart[b + 1]; e++) {
+          int p = to[e];
+          if (cfg.sccOf[p] == c && !queued[p]) {
+            queued[p] = true;
+            worklist[(front + count) % size] = p;
+            count++;
+          }
+        }
+      }
+      hooks.leave(c);
+    }
+  }
+
+  // Solves a backward problem over the blocks of a reducible cfg without
+  // iterating, given its loop-nesting forest; otherwise as solve(), and
+  // visits[0] gets the number of block visits.
+  //
+  // One sweep visits blocks in postorder, so every forward edge is taken
+  // from an up-to-date successor. A sweep over the whole CFG makes every
+  // block outside all loops final, as well as the header of every outermost
+  // loop: a path that is live through adds nothing once its cycles are cut
+  // out, and a simple path from such a block can take no back edge. A
+  // sweep over the body of a loop, once its header is final, likewise makes
+  // final its blocks outside inner loops and the headers of those, so the
+  // loops are swept outer before inner. Each block is visited once per loop
+  // around it, plus once.
+  template< typename Lattice, typename Transfer >
+  void solve_loops(const CFG & cfg, const LoopForest & forest, const Lattice & l, const Transfer & t,
+                   typename Lattice::Store & BIN, typename Lattice::Store & BOUT, std::vector<int64_t> *visits) {
+    visits->assign(1, 0);
+    int fanOut = 0;
+    for (int b = 0; b < cfg.size(); b++) {
+      fanOut = std::max(fanOut, cfg.succStart[b + 1] - cfg.succStart[b]);
+    }
+    std::vector<typename Lattice::ConstValue> values(fanOut);
+    auto sweep = [&](const int *blocks, int n) {
+      for (int i = 0; i < n; i++) {
+        int b = blocks[i];
+        int count = 0;
+        for (int e = cfg.succStart[b]; e < cfg.succStart[b + 1]; e++) {
+          values[count++] = l.at(BIN, cfg.succ[e]);
+        }
+        l.meet_n(l.at(BOUT, b), values.data(), count);
+        t(l, l.at(BIN, b), l.at(BOUT, b), b);
+      }
+      (*visits)[0] += n;
+    };
+    sweep(forest.post.data(), forest.post.size());
+    for (int k = 0; k < forest.loops(); k++) {
+      sweep(forest.loopBlock.data() + forest.loopStart[k], forest.loopStart[k + 1] - forest.loopStart[k]);
+    }
+  }
+
+  // Recovers the per-instruction IN and OUT from the block solution with one
+  // walk per block in the direction of the flow; t is the transfer of one
+  // instruction.
+  template< DIRECTION D, typename Lattice, typename Transfer >
+  void expand(const CFG & cfg, const Lattice & l, const Transfer & t,
+              const typename Lattice::Store & BIN, const typename Lattice::Store & BOUT,
+              typename Lattice::Store & IN, typename Lattice::Store & OUT) {
+    for (int b = 0; b < cfg.size(); b++) {
+      if (D == BACKWARD) {
+        typename Lattice::ConstValue out = l.at(BOUT, b);
+        for (int k = cfg.start[b + 1] - 1; k >= cfg.start[b]; k--) {
+          l.copy(l.at(OUT, k), out);
+          t(l, l.at(IN, k), out, k);
+          out = l.at(IN, k);
+        }
+      } else {
+        typename Lattice::ConstValue in = l.at(BIN, b);
+        for (int k = cfg.start[b]; k < cfg.start[b + 1]; k++) {
+          l.copy(l.at(IN, k), in);
+          t(l, l.at(OUT, k), in, k);
+          in = l.at(OUT, k);
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,58 @@
+// by: Zhiping
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <genkill.h>
+
+namespace L2 {
+
+  void build_var_index(VarIndex * vars, Function * func) {
+    std::vector<uint32_t> symbols;
+    for (int k = 0; k < (int)func->instructions.size(); k++) {
+      const Instruction & i = func->instructions[k];
+      const UseDef & d = func->useDefs[k];
+      for (unsigned m = d.reads | d.writes; m; m &= m - 1) {
+        uint32_t sym = i.items[__builtin_ctz(m)].payload();
+        if (!is_register(sym)) {
+          symbols.push_back(sym);
+        }
+      }
+    }
+    std::sort(symbols.begin(), symbols.end());
+    symbols.erase(std::unique(symbols.begin(), symbols.end()), symbols.end());
+
+    const Symbols *table = func->symbols;
+    std::sort(symbols.begin(), symbols.end(), [table](uint32_t a, uint32_t b) {
+      return table->name(a) < table->name(b);
+    });
+    vars->names.clear();
+    vars->registersBefore.clear();
+    vars->index.clear();
+    for (int r = 0; r < REGISTERS; r++) {
+      vars->names.push_back(table->name(r).c_str());
+      vars->registersBefore.push_back(r);
+    }
+    // Register ids are in name order too, so one merge pass finds where each
+    // variable falls among them.
+    int r = 0;
+    for (auto sym : symbols) {
+      const Name & name = table->name(sym);
+      while (r < REGISTERS && table->name(r) < name) {
+        r++;
+      }
+      vars->index[sym] = vars->names.size();
+      vars->names.push_back(name.c_str());
+      vars->registersBefore.push_back(r);
+    }
+  }
+
+  void gen_gen_kill_bits(word_t * GEN, word_t * KILL, Function * func, int k, const VarIndex & vars) {
+    for_each_gen_kill(func, k, vars, [GEN](int v) {
+      bv_set(GEN, v);
+    }, [KILL](int v) {
+      bv_set(KILL, v);
+    });
+  }
+}
@@ -0,0 +1,63 @@
+// by: Zhiping
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <L2.h>
+#include <bitvector.h>
+#include <registers.h>
+
+namespace L2 {
+
+  // Dense numbering of the values of one function. The registers sit at
+  // their fixed indices 0..15 (see registers.h), and every variable of the
+  // function is interned once to a dense index from L2::REGISTERS up, handed
+  // out in name order.
+  struct VarIndex {
+    std::vector<std::string> names;            // dense index -> name
+    std::vector<int> registersBefore;          // dense index -> registers sorting before it
+    std::unordered_map<uint32_t, int> index;   // variable symbol id -> dense index
+
+    int size() const {
+      return names.size();
+    }
+
+    int of(uint32_t sym) const {
+      return is_register(sym) ? (int)sym : index.at(sym);
+    }
+
+    int of(Item i) const {
+      return of(i.payload());
+    }
+  };
+
+  void build_var_index(VarIndex * vars, Function * func);
+
+  // Calls gen(v) for every value instruction k of func reads and kill(v) for
+  // every value it writes, v being a dense index of vars. This reads the
+  // use/def table the parser filled in (see L2::UseDef); the registers a
+  // call reads are reported before those it writes.
+  template< typename Gen, typename Kill >
+  void for_each_gen_kill(Function * func, int k, const VarIndex & vars, Gen gen, Kill kill) {
+    const Instruction & i = func->instructions[k];
+    const UseDef & d = func->useDefs[k];
+    for (regmask_t m = d.gen; m; m &= m - 1) {
+      gen(__builtin_ctz(m));
+    }
+    for (unsigned m = d.reads; m; m &= m - 1) {
+      gen(vars.of(i.items[__builtin_ctz(m)]));
+    }
+    for (regmask_t m = d.kill; m; m &= m - 1) {
+      kill(__builtin_ctz(m));
+    }
+    for (unsigned m = d.writes; m; m &= m - 1) {
+      kill(vars.of(i.items[__builtin_ctz(m)]));
+    }
+  }
+
+  // ORs the GEN and KILL bits of instruction k of func into GEN and KILL.
+  void gen_gen_kill_bits(word_t * GEN, word_t * KILL, Function * func, int k, const VarIndex & vars);
+}
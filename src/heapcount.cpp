@@ -0,0 +1,63 @@
+// by: Zhiping
+
+#include <new>
+#include <cstdlib>
+
+#include <heapcount.h>
+
+namespace L2 {
+
+  static thread_local int64_t allocations = 0;
+
+  int64_t heap_allocations() {
+    return allocations;
+  }
+}
+
+// Retries through the new_handler, as the library operator new does.
+void *operator new(std::size_t size) {
+  L2::allocations++;
+  for (;;) {
+    void *p = std::malloc(size ? size : 1);
+    if (p) {
+      return p;
+    }
+    std::new_handler handler = std::get_new_handler();
+    if (!handler) {
+      throw std::bad_alloc();
+    }
+    handler();
+  }
+}
+
+void *operator new[](std::size_t size) {
+  return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  try {
+    return operator new(size);
+  } catch (const std::bad_alloc &) {
+    return nullptr;
+  }
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return operator new(size, std::nothrow);
+}
+
+void operator delete(void *p) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+  std::free(p);
+}
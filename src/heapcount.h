@@ -0,0 +1,17 @@
+// by: Zhiping
+
+#pragma once
+
+#include <stdint.h>
+
+namespace L2 {
+
+  // Heap allocations made so far by the calling thread, through any form of
+  // operator new. heapcount.cpp replaces the global operator new and delete
+  // to keep the count; the solvers use it to check that a visit that changes
+  // nothing allocates nothing either.
+  //
+  // Only the test binary bin/L2-heapcheck links heapcount.cpp, with every
+  // source built with L2_COUNT_HEAP; bin/L2 keeps the library allocator.
+  int64_t heap_allocations();
+}
@@ -0,0 +1,315 @@
+// by: Zhiping
+
+#include <vector>
+#include <algorithm>
+
+#include <incremental.h>
+
+namespace L2 {
+
+  static bool is_control(const Instruction & i) {
+    return i.type == INS::LABEL_INS || i.type == INS::GOTO || i.type == INS::CJUMP || i.type == INS::RETURN;
+  }
+
+  // Only labels are targets, and a removed instruction is never one, so
+  // every target from k on moves by the shift.
+  static void shift_targets(Instruction & i, int k, int shift) {
+    for (int t = 0; t < i.size; t++) {
+      if (i.items[t].tag() == Item::TARGET_TAG && (int)i.items[t].payload() >= k) {
+        i.items[t] = Item::make(Item::TARGET_TAG, i.items[t].payload() + shift);
+      }
+    }
+  }
+
+  // Edits the instructions and their use/def table alike.
+  static int edit_instructions(Function * func, const Edit & e) {
+    auto & ins = func->instructions;
+    auto & uds = func->useDefs;
+    switch (e.kind) {
+      case EDIT::INSERT:
+            ins.insert(ins.begin() + e.k, e.i);
+            uds.insert(uds.begin() + e.k, e.d);
+            return 1;
+      case EDIT::REMOVE:
+            ins.erase(ins.begin() + e.k);
+            uds.erase(uds.begin() + e.k);
+            return -1;
+      default:
+            ins[e.k] = e.i;
+            uds[e.k] = e.d;
+            return 0;
+    }
+  }
+
+  void apply_edit(Function * func, const Edit & e) {
+    int shift = edit_instructions(func, e);
+    for (int k = 0; shift != 0 && k < (int)func->instructions.size(); k++) {
+      shift_targets(func->instructions[k], e.k, shift);
+    }
+  }
+
+  // Sets s to the value before instruction k given the value after it: the
+  // writes are taken out before the reads are put in, whatever order
+  // for_each_gen_kill reports them in.
+  struct InstructionTransfer {
+    Function *func;
+    const VarIndex & vars;
+
+    void operator()(const IncrementalLiveness::Lattice & l, word_t *s, const word_t *out, int k) const {
+      if (s != out) {
+        l.copy(s, out);
+      }
+      for_each_gen_kill(func, k, vars, [](int v) {}, [s](int v) {
+        bv_reset(s, v);
+      });
+      for_each_gen_kill(func, k, vars, [s](int v) {
+        bv_set(s, v);
+      }, [](int v) {});
+    }
+  };
+
+  IncrementalLiveness::IncrementalLiveness(Function * func) : func(func), l(0) {
+    build_var_index(&vars, func);
+    l = Lattice(bv_words(vars.size()));
+    solve_all();
+  }
+
+  void IncrementalLiveness::solve_all() {
+    build_cfg(&cfg, func);
+    int B = cfg.size();
+    BGEN = l.make(B);
+    BKILL = l.make(B);
+    for (int b = 0; b < B; b++) {
+      summarize_block(b, l.at(BGEN, b), l.at(BKILL, b));
+    }
+    BIN = l.make(B);
+    BOUT = l.make(B);
+    std::vector<int64_t> visits;
+    solve<BACKWARD>(cfg, l, GenKill<Lattice>{BGEN, BKILL}, BIN, BOUT, &visits);
+    for (auto v : visits) {
+      visited += v;
+    }
+    pending = l.make(B);
+    queued.assign(B, false);
+    solved++;
+  }
+
+  // Gives the values i mentions that are new to the function the next
+  // dense indices, widening every row when they no longer fit.
+  void IncrementalLiveness::add_values(const Instruction & i) {
+    for (int t = 0; t < i.size; t++) {
+      Item it = i.items[t];
+      if (!is_live_item(it) || is_register(it.payload()) || vars.index.count(it.payload())) {
+        continue;
+      }
+      vars.index[it.payload()] = vars.size();
+      vars.names.push_back(func->name_of(it).c_str());
+      vars.registersBefore.push_back(REGISTERS);
+    }
+    int words = bv_words(vars.size());
+    if (words <= l.words) {
+      return;
+    }
+    words = std::max(words, 2 * l.words);
+    Lattice wider(words);
+    for (Lattice::Store * s : {&BGEN, &BKILL, &BIN, &BOUT, &pending}) {
+      Lattice::Store t = wider.make(cfg.size());
+      for (int b = 0; b < cfg.size(); b++) {
+        bv_copy(wider.at(t, b), l.at(*s, b), l.words);
+      }
+      s->swap(t);
+    }
+    l = wider;
+  }
+
+  int IncrementalLiveness::block_of(int k) const {
+    return std::upper_bound(cfg.start.begin(), cfg.start.end(), k) - cfg.start.begin() - 1;
+  }
+
+  void IncrementalLiveness::summarize_block(int b, word_t * gen, word_t * kill) const {
+    bv_clear(gen, l.words);
+    bv_clear(kill, l.words);
+    InstructionTransfer t{func, vars};
+    for (int k = cfg.start[b + 1] - 1; k >= cfg.start[b]; k--) {
+      t(l, gen, gen, k);
+      for_each_gen_kill(func, k, vars, [](int v) {}, [kill](int v) {
+        bv_set(kill, v);
+      });
+    }
+  }
+
+  void IncrementalLiveness::update(const Edit & e) {
+    int n = func->instructions.size();
+    bool local = e.kind == EDIT::INSERT ? !is_control(e.i) : !is_control(func->instructions[e.k]);
+    if (e.kind == EDIT::REPLACE) {
+      local = local && !is_control(e.i);
+    }
+
+    // The block that gets the inserted instruction: the one of k - 1 if
+    // control falls from it into k, otherwise the one k starts, unless the
+    // instruction would start a block of its own.
+    int h = -1;
+    if (local && e.kind == EDIT::INSERT) {
+      if (e.k > 0 && !is_control(func->instructions[e.k - 1])) {
+        h = block_of(e.k - 1);
+      } else if (e.k < n && func->instructions[e.k].type != INS::LABEL_INS) {
+        h = block_of(e.k);
+      }
+    } else if (local) {
+      h = block_of(e.k);
+      if (e.kind == EDIT::REMOVE && cfg.start[h + 1] - cfg.start[h] == 1) {
+        h = -1;
+      }
+    }
+
+    if (h < 0) {
+      apply_edit(func, e);
+      add_values(e.i);
+      solve_all();
+      return;
+    }
+
+    int shift = edit_instructions(func, e);
+    if (e.kind != EDIT::REMOVE) {
+      add_values(e.i);
+    }
+    for (int b = h + 1; b <= cfg.size(); b++) {
+      cfg.start[b] += shift;
+    }
+    // The jumps are the last instructions of their blocks, so only those
+    // need their targets moved.
+    for (int b = 0; shift != 0 && b < cfg.size(); b++) {
+      shift_targets(func->instructions[cfg.start[b + 1] - 1], e.k, shift);
+    }
+    repropagate(h);
+  }
+
+  void IncrementalLiveness::repropagate(int h) {
+    int W = l.words;
+    Lattice::Store summary = l.make(2);
+    word_t *gen = l.at(summary, 0), *kill = l.at(summary, 1);
+    summarize_block(h, gen, kill);
+
+    // Values whose summary changed; they keep only the bits the new GEN of
+    // h still generates there.
+    std::vector<word_t> changed(W), clear(W);
+    word_t *hin = l.at(BIN, h), *hgen = l.at(BGEN, h), *hkill = l.at(BKILL, h);
+    bool any = false;
+    for (int w = 0; w < W; w++) {
+      changed[w] = (hgen[w] ^ gen[w]) | (hkill[w] ^ kill[w]);
+      clear[w] = hin[w] & changed[w] & ~gen[w];
+      hin[w] &= ~clear[w];
+      any = any || changed[w];
+    }
+    l.copy(hgen, gen);
+    l.copy(hkill, kill);
+    if (!any) {
+      return;
+    }
+
+    // Clearing: a bit taken out of IN[b] is taken out of OUT[p] of every
+    // predecessor p having it, and out of IN[p] too unless p generates it.
+    // pending[p] collects the bits taken out of the successors of p.
+    touched.clear();
+    touched.push_back(h);
+    auto clear_into_preds = [&](int b, const word_t *c) {
+      for (int e = cfg.predStart[b]; e < cfg.predStart[b + 1]; e++) {
+        int p = cfg.pred[e];
+        l.unite(l.at(pending, p), c);
+        if (!queued[p]) {
+          queued[p] = true;
+          worklist.push_back(p);
+        }
+      }
+    };
+    if (std::any_of(clear.begin(), clear.end(), [](word_t w) { return w != 0; })) {
+      clear_into_preds(h, &clear[0]);
+    }
+    while (!worklist.empty()) {
+      int p = worklist.back();
+      worklist.pop_back();
+      queued[p] = false;
+      word_t *c = l.at(pending, p), *in = l.at(BIN, p), *out = l.at(BOUT, p), *pgen = l.at(BGEN, p);
+      bool cleared = false, passed = false;
+      for (int w = 0; w < W; w++) {
+        word_t bits = c[w] & out[w];
+        out[w] &= ~bits;
+        c[w] = bits & in[w] & ~pgen[w];
+        in[w] &= ~c[w];
+        cleared = cleared || bits;
+        passed = passed || c[w];
+      }
+      if (cleared) {
+        touched.push_back(p);
+      }
+      if (passed) {
+        clear_into_preds(p, c);
+      }
+      bv_clear(c, W);
+    }
+
+    // Re-solving, from every block that changed.
+    std::size_t front = 0;
+    for (auto b : touched) {
+      if (!queued[b]) {
+        queued[b] = true;
+        worklist.push_back(b);
+      }
+    }
+    while (front < worklist.size()) {
+      int b = worklist[front++];
+      queued[b] = false;
+      visited++;
+      word_t *out = l.at(BOUT, b);
+      bv_clear(out, W);
+      for (int e = cfg.succStart[b]; e < cfg.succStart[b + 1]; e++) {
+        l.meet(out, l.at(BIN, cfg.succ[e]));
+      }
+      if (!l.transfer_changed(l.at(BIN, b), l.at(BGEN, b), out, l.at(BKILL, b))) {
+        continue;
+      }
+      for (int e = cfg.predStart[b]; e < cfg.predStart[b + 1]; e++) {
+        int p = cfg.pred[e];
+        if (!queued[p]) {
+          queued[p] = true;
+          worklist.push_back(p);
+        }
+      }
+    }
+    worklist.clear();
+  }
+
+  bool IncrementalLiveness::live_from(int v, int k) const {
+    int b = block_of(k);
+    for (; k < cfg.start[b + 1]; k++) {
+      bool read = false, written = false;
+      for_each_gen_kill(func, k, vars, [&](int u) {
+        read = read || u == v;
+      }, [&](int u) {
+        written = written || u == v;
+      });
+      if (read || written) {
+        return read;
+      }
+    }
+    return bv_test(l.at(BOUT, b), v);
+  }
+
+  bool IncrementalLiveness::is_live_in(int v, int k) const {
+    return live_from(v, k);
+  }
+
+  bool IncrementalLiveness::is_live_out(int v, int k) const {
+    if (k + 1 == cfg.start[block_of(k) + 1]) {
+      return bv_test(l.at(BOUT, block_of(k)), v);
+    }
+    return live_from(v, k + 1);
+  }
+
+  void IncrementalLiveness::sets(Lattice::Store & IN, Lattice::Store & OUT) const {
+    int n = func->instructions.size();
+    IN = l.make(n);
+    OUT = l.make(n);
+    expand<BACKWARD>(cfg, l, InstructionTransfer{func, vars}, BIN, BOUT, IN, OUT);
+  }
+}
@@ -0,0 +1,114 @@
+// by: Zhiping
+
+#pragma once
+
+#include <vector>
+
+#include <L2.h>
+#include <cfg.h>
+#include <genkill.h>
+#include <dataflow.h>
+
+namespace L2 {
+
+  // A local edit of a function: insert instruction i before instruction k
+  // (k may be the instruction count, to append), remove instruction k, or
+  // replace instruction k by i. d is what i reads and writes, as the parser
+  // would have recorded it.
+  enum EDIT {
+    INSERT, REMOVE, REPLACE
+  };
+
+  struct Edit {
+    EDIT kind;
+    int k;
+    Instruction i;
+    UseDef d;
+  };
+
+  // Applies e to func, renumbering the goto/cjump targets after k.
+  void apply_edit(Function * func, const Edit & e);
+
+  // Block liveness of one function kept up to date across edits.
+  //
+  // The structure holds the GEN/KILL summary and the IN/OUT solution of
+  // every block. update() applies an edit and, as long as the edit leaves
+  // the blocks and their edges alone (no label, goto, cjump or return is
+  // inserted, removed or replaced, and no block is created or emptied),
+  // re-propagates only from the edited block:
+  //   - the values whose GEN or KILL changed in that block may now be live
+  //     in fewer places, so, walking the predecessors from it, their bits
+  //     are cleared wherever they were only live through it, as in
+  //     delete-and-rederive maintenance of a least fixpoint;
+  //   - a worklist then re-solves the edited block and every block that
+  //     lost a bit, and the blocks before them, until no IN set changes.
+  // Every other bit of every block is untouched, so the cost follows the
+  // region whose liveness actually changed. Any other edit rebuilds the CFG
+  // and solves it again.
+  //
+  // A value an edit introduces gets the next dense index, so values() is in
+  // name order only up to the values of the original function.
+  class IncrementalLiveness {
+  public:
+    typedef BitLattice<Union> Lattice;
+
+    explicit IncrementalLiveness(Function * func);
+
+    void update(const Edit & e);
+
+    const VarIndex & values() const {
+      return vars;
+    }
+
+    const CFG & graph() const {
+      return cfg;
+    }
+
+    bool is_live_in(int v, int k) const;
+    bool is_live_out(int v, int k) const;
+
+    // The per-instruction IN and OUT sets, rows of lattice().words words.
+    void sets(Lattice::Store & IN, Lattice::Store & OUT) const;
+
+    const Lattice & lattice() const {
+      return l;
+    }
+
+    // Block visits spent solving, in full or incrementally, and the number
+    // of full solves, the first one included.
+    int64_t visits() const {
+      return visited;
+    }
+
+    int64_t solves() const {
+      return solved;
+    }
+
+  private:
+    void solve_all();
+
+    void add_values(const Instruction & i);
+
+    int block_of(int k) const;
+
+    // Whether v is read, in the block of k, by instruction k or a later one
+    // before anything writes it; if neither happens, whether it is live out
+    // of the block.
+    bool live_from(int v, int k) const;
+
+    void summarize_block(int b, word_t * gen, word_t * kill) const;
+
+    void repropagate(int h);
+
+    Function * func;
+    VarIndex vars;
+    CFG cfg;
+    Lattice l;
+    Lattice::Store BGEN, BKILL, BIN, BOUT;
+    Lattice::Store pending;   // bits still to clear on entering a block, zero between updates
+    std::vector<bool> queued;
+    std::vector<int> worklist, touched;
+    int64_t visited = 0;
+    int64_t solved = 0;
+  };
+}
@@ -14,8 +14,27 @@
 #include <unistd.h>
 #include <fstream>
 #include <map>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <sys/resource.h>
 
 #include <parser.h>
+#include <bitvector.h>
+#include <cfg.h>
+#include <registers.h>
+#include <writer.h>
+#include <heapcount.h>
+#include <liveset.h>
+#include <ranges.h>
+#include <dataflow.h>
+#include <genkill.h>
+#include <query.h>
+#include <incremental.h>
 
 using namespace std;
 
@@ -24,11 +43,9 @@ std::set<std::string> caller_save_regs = {"r10", "r11", "r8", "r9", "rax", "rcx"
 std::vector<std::string> args_regs = {"rdi", "rsi", "rdx", "rcx", "r8", "r9"};
 
 // utility
-void insert_item_to_set(std::set<std::string> * s, L2::Item * i) {
-  if (i->type == L2::ITEM::REGISTER || i->type == L2::ITEM::VAR) {
-    if (i->name != "rsp" && i->name != "print" && i->name != "allocate" && i->name != "array-error") {
-      s->insert(i->name);
-    }
+void insert_item_to_set(std::set<std::string> * s, L2::Item i, L2::Function * func) {
+  if ((i.type() == L2::ITEM::REGISTER || i.type() == L2::ITEM::VAR) && !L2::is_never_live(i.payload())) {
+    s->insert(func->name_of(i).c_str());
   }
 }
 
@@ -36,79 +53,64 @@ void union_set(std::set<std::string> * s, std::set<std::string> * t) {
   s->insert(t->begin(), t->end());
 }
 
-void union_set(std::set<std::string> * s, std::vector<std::string> * t, int n) {
+// Adds the first n strings of t, or all of them when n is larger.
+void union_set(std::set<std::string> * s, std::vector<std::string> * t, int64_t n) {
+  n = std::min<int64_t>(n, t->size());
   for (int i = 0; i < n; i++) {
     s->insert(t->at(i));
   }
 }
 
-std::set<std::string> minus_set(std::set<std::string> * s, std::set<std::string> * t) {
-  std::set<std::string> result;
-  std::set_difference(s->begin(), s->end(), t->begin(), t->end(), std::inserter(result, result.end()));
-  return result;
-}
-
-std::map<std::string, int> build_label_map(std::vector<L2::Instruction *> instructions) {
-  std::map<std::string, int> result;
-  for (int k = 0; k < instructions.size(); k++) {
-    L2::Instruction * i = instructions.at(k);
-    if (i->type == L2::INS::LABEL_INS) {
-      result[i->items.at(0)->name] = k;
-    }
-  }
-  return result;
-}
-
-void gen_gen_kill(std::set<std::string> * GEN, std::set<std::string> * KILL, L2::Instruction * i) {
-  switch (i->type) {
+void gen_gen_kill(std::set<std::string> * GEN, std::set<std::string> * KILL, const L2::Instruction & i, L2::Function * func) {
+  switch (i.type) {
     case L2::INS::RETURN:
             GEN->insert(callee_save_regs.begin(), callee_save_regs.end());
             GEN->insert("rax");
             break;
     // case L2::INS::LABEL_INS:
     //         break;
-    case L2::INS::MEM_START:
-            insert_item_to_set(KILL, i->items.at(0));
-            if (i->op != "<-") {
-              insert_item_to_set(GEN, i->items.at(0));
+    case L2::INS::MEM_START: // (mem x M) op s
+            insert_item_to_set(KILL, i.items[0], func);
+            if (i.op != L2::OP::MOVE) {
+              insert_item_to_set(GEN, i.items[0], func);
             }
-            insert_item_to_set(GEN, i->items.at(1));
+            insert_item_to_set(GEN, i.items[2], func);
             break;
     case L2::INS::W_START:
-            insert_item_to_set(KILL, i->items.at(0));
-            if (i->op != "<-") {
-              insert_item_to_set(GEN, i->items.at(0));
+            insert_item_to_set(KILL, i.items[0], func);
+            if (i.op != L2::OP::MOVE) {
+              insert_item_to_set(GEN, i.items[0], func);
             }
-            insert_item_to_set(GEN, i->items.at(1));
+            insert_item_to_set(GEN, i.items[1], func);
             break;
     case L2::INS::CALL:
-            union_set(GEN, &args_regs, i->items.at(0)->value);
-            insert_item_to_set(GEN, i->items.at(0));
+            union_set(GEN, &args_regs, func->value_of(i.items[1]));
+            insert_item_to_set(GEN, i.items[0], func);
             union_set(KILL, &caller_save_regs);
             KILL->insert("rax");
             break;
     // case L2::INS::GOTO:
     //         break;
     case L2::INS::INC_DEC:
-            insert_item_to_set(KILL, i->items.at(0));
-            insert_item_to_set(GEN, i->items.at(0));
+            insert_item_to_set(KILL, i.items[0], func);
+            insert_item_to_set(GEN, i.items[0], func);
             break;
     case L2::INS::CISC:
-            insert_item_to_set(KILL, i->items.at(0));
-            insert_item_to_set(GEN, i->items.at(1));
-            insert_item_to_set(GEN, i->items.at(2));
+            insert_item_to_set(KILL, i.items[0], func);
+            insert_item_to_set(GEN, i.items[1], func);
+            insert_item_to_set(GEN, i.items[2], func);
             break;
     case L2::INS::CMP:
-            insert_item_to_set(KILL, i->items.at(0));
-            insert_item_to_set(GEN, i->items.at(1));
-            insert_item_to_set(GEN, i->items.at(2));
+            insert_item_to_set(KILL, i.items[0], func);
+            insert_item_to_set(GEN, i.items[1], func);
+            insert_item_to_set(GEN, i.items[2], func);
             break;
     case L2::INS::CJUMP:
-            insert_item_to_set(GEN, i->items.at(0));
-            insert_item_to_set(GEN, i->items.at(1));
+            insert_item_to_set(GEN, i.items[0], func);
+            insert_item_to_set(GEN, i.items[1], func);
             break;
     case L2::INS::STACK:
-            insert_item_to_set(KILL, i->items.at(0));
+            insert_item_to_set(KILL, i.items[0], func);
             // KILL->insert("rsp");
             break;
     default:
@@ -127,123 +129,1017 @@ void gen_gen_kill(std::set<std::string> * GEN, std::set<std::string> * KILL, L2:
   // }
 }
 
-void liveness_analyze(L2::Function *func) {
+// Counters reported by -s.
+struct LivenessStats {
+  int64_t blocks = 0; // dataflow nodes: instructions or basic blocks
+  int64_t visits = 0; // dataflow node evaluations until the fixpoint
+  double genkill = 0;  // seconds spent building GEN and KILL
+  int64_t sets = 0;    // bytes held by the per-instruction IN and OUT sets
+  int64_t sccs = 0;    // strongly connected components of the block CFG
+  std::vector<std::pair<int, int64_t>> loops; // cyclic SCCs: (blocks, visits)
+  int64_t forest = -1;       // loops in the forest, when solved over it
+  bool irreducible = false;  // the forest solver fell back to iteration
+  int64_t edits = 0;         // local edits replayed by the incremental engine
+  double solve = 0;          // seconds of its first, full solve
+  double edit = 0;           // seconds spent in its local updates and queries
+  int64_t solves = 0;        // full solves, the first one included
+  int64_t steady = -1;       // heap allocations of the visits that changed nothing, when iterating (L2-heapcheck)
+  int64_t rows = -1;         // bytes of block rows held at most, when they are pooled
+};
+
+// Records the block visits of L2::solve, per SCC of cfg.
+void count_visits(LivenessStats *stats, const L2::CFG & cfg, const std::vector<int64_t> & visits) {
+  stats->sccs = cfg.components();
+  for (int c = 0; c < cfg.components(); c++) {
+    stats->visits += visits[c];
+    if (cfg.cyclic[c]) {
+      stats->loops.push_back(std::make_pair(cfg.sccStart[c + 1] - cfg.sccStart[c], visits[c]));
+    }
+  }
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+  return d.count();
+}
+
+// Prints one row of the result: "(a b c)".
+void print_set(L2::Writer & os, const std::set<std::string> & s) {
+  os << '(';
+  const char *sep = "";
+  for (auto & reg : s) {
+    os << sep << reg;
+    sep = " ";
+  }
+  os << ")\n";
+}
+
+// Reference engine: one std::set<std::string> per GEN/KILL/IN/OUT.
+void liveness_analyze_set(L2::Function *func, L2::Writer & os, LivenessStats *stats) {
   int n = func->instructions.size();
+  stats->blocks = n;
 
-  std::set<std::string> GEN[n];
-  std::set<std::string> KILL[n];
+  // GEN, KILL, IN and OUT are four runs of n sets in one heap slab. Each
+  // thread keeps its slab across functions, so it only grows to the largest
+  // function seen and is emptied again after every function.
+  static thread_local std::vector<std::set<std::string>> slab;
+  if (slab.size() < 4 * (std::size_t)n) {
+    slab.resize(4 * (std::size_t)n);
+  }
+  std::set<std::string> *GEN = slab.data(), *KILL = GEN + n, *IN = KILL + n, *OUT = IN + n;
 
+  auto genkill_start = std::chrono::steady_clock::now();
   for (int k = 0; k < n; k++) {
-    L2::Instruction *i = func->instructions.at(k);
-
-    gen_gen_kill(&GEN[k], &KILL[k], i);
+    gen_gen_kill(&GEN[k], &KILL[k], func->instructions[k], func);
     // We need to build GEN and KILL here
   }
+  stats->genkill = seconds_since(genkill_start);
 
-  std::map<std::string, int> labelNextIndexMap = build_label_map(func->instructions);
-
-  std::set <std::string> IN[n];
-  std::set <std::string> OUT[n];
-  int converge_count;
+  // Sweep backwards, the way liveness flows, until a sweep changes nothing.
+  // The sets only ever grow, so they are updated in place: IN starts out as
+  // GEN, and a visit inserts into OUT and IN whatever they lack. Whether a
+  // visit changed anything is whether an insertion took place; IN can only
+  // change when OUT grew. A visit that changes nothing only looks values up,
+  // so it allocates nothing.
+  for (int k = 0; k < n; k++) {
+    IN[k] = GEN[k];
+  }
+  std::vector<int> next_indexs;
+#ifdef L2_COUNT_HEAP
+  stats->steady = 0;
+#endif
+  int converge_count = 0;
   while (converge_count != n) {
     converge_count = 0;
 
-    for (int k = 0; k < n; k++) {
-      std::set <std::string> newIn;
-      std::set <std::string> newOut;
-      L2::Instruction *cur_ins = func->instructions.at(k);
-
-      // IN[i] = GEN[i] U (OUT[i] - KILL[i])
-      union_set(&newIn, &GEN[k]);
-      std::set <std::string> diff = minus_set(&OUT[k], &KILL[k]);
-      union_set(&newIn, &diff);
+    for (int k = n - 1; k >= 0; k--) {
+      stats->visits++;
+#ifdef L2_COUNT_HEAP
+      int64_t before = L2::heap_allocations();
+#endif
 
       // OUT[i] = U (s a successor of i) IN[s]
-      std::vector< int > next_indexs;
-
-      switch (cur_ins->type) {
-        case L2::INS::GOTO:
-              next_indexs.push_back(labelNextIndexMap[cur_ins->items.at(0)->name]);
-              break;
-        case L2::INS::CJUMP:
-              if (cur_ins->items.at(0)->type == L2::ITEM::NUMBER && cur_ins->items.at(1)->type == L2::ITEM::NUMBER) {
-                if ((cur_ins->op == "<=" && cur_ins->items.at(0)->value <= cur_ins->items.at(1)->value)
-                  || (cur_ins->op == "<" && cur_ins->items.at(0)->value < cur_ins->items.at(1)->value)
-                  || (cur_ins->op == "=" && cur_ins->items.at(0)->value == cur_ins->items.at(1)->value)) {
-                    next_indexs.push_back(labelNextIndexMap[cur_ins->items.at(2)->name]);
-                } else {
-                  next_indexs.push_back(labelNextIndexMap[cur_ins->items.at(3)->name]);
-                }
-              } else {
-                next_indexs.push_back(labelNextIndexMap[cur_ins->items.at(2)->name]);
-                next_indexs.push_back(labelNextIndexMap[cur_ins->items.at(3)->name]);
-              }
-              break;
-        default: // For normal situation
-              next_indexs.push_back(k+1);
-              break;
-      }
-      union_set(&newOut, &OUT[k]);
+      next_indexs.clear();
+      L2::find_successors(&next_indexs, func, k);
+      std::size_t outSize = OUT[k].size();
       for (int next_index : next_indexs) {
         if (next_index < n) {
-          union_set(&newOut, &IN[next_index]);
+          union_set(&OUT[k], &IN[next_index]);
         }
       }
 
-      if (IN[k] == newIn && OUT[k] == newOut) {
+      if (OUT[k].size() == outSize) {
         converge_count++;
-      } else {
-        IN[k] = newIn;
-        OUT[k] = newOut;
+#ifdef L2_COUNT_HEAP
+        stats->steady += L2::heap_allocations() - before;
+#endif
+        continue;
+      }
+
+      // IN[i] = GEN[i] U (OUT[i] - KILL[i]), from the OUT just grown
+      for (auto & v : OUT[k]) {
+        if (!KILL[k].count(v)) {
+          IN[k].insert(v);
+        }
       }
     }
   }
+  // A set node holds the string and the tree links; short names need no
+  // further heap.
+  for (int k = 0; k < n; k++) {
+    stats->sets += (IN[k].size() + OUT[k].size()) * (sizeof(std::string) + 4 * sizeof(void *));
+  }
+
   // print in & out
-  cout << "(\n(in\n";
+  os << "(\n(in\n";
   for (int k = 0; k < n; k++) {
-    cout << "(";
-    for (auto reg : IN[k]) {
-        cout << reg << " ";
+    print_set(os, IN[k]);
+  }
+  os << ")\n\n(out\n";
+  for (int k = 0; k < n; k++) {
+    print_set(os, OUT[k]);
+  }
+  os << ")\n\n)\n";
+
+  for (int k = 0; k < 4 * n; k++) {
+    slab[k].clear();
+  }
+}
+
+// One row of a bit-vector slab, as seen by print_row.
+struct BitsRow {
+  const L2::word_t *s;
+  int words;
+
+  template< typename F >
+  void for_each(F f) const {
+    L2::bv_for_each(s, words, f);
+  }
+};
+
+// Prints one row of the result. row.for_each(f) calls f on the dense indices
+// of the row in increasing order, so the registers come first; they are
+// merged into the variables, which are already sorted among themselves.
+template< typename Row >
+void print_row(L2::Writer & os, const Row & row, const L2::VarIndex & vars) {
+  L2::regmask_t regs = 0;
+  const char *sep = "";
+  auto print = [&](int v) {
+    os << sep << vars.names[v];
+    sep = " ";
+  };
+  os << '(';
+  row.for_each([&](int v) {
+    if (v < L2::REGISTERS) {
+      regs |= L2::reg_bit(v);
+      return;
     }
-    cout << ")\n";
+    while (regs && __builtin_ctz(regs) < vars.registersBefore[v]) {
+      print(__builtin_ctz(regs));
+      regs &= regs - 1;
+    }
+    print(v);
+  });
+  for (; regs; regs &= regs - 1) {
+    print(__builtin_ctz(regs));
+  }
+  os << ")\n";
+}
+
+void print_bits(L2::Writer & os, const std::vector<L2::word_t> & rows, int n, int words, const L2::VarIndex & vars) {
+  for (int k = 0; k < n; k++) {
+    print_row(os, BitsRow{&rows[k * words], words}, vars);
   }
-  cout << ")\n\n(out\n";
+}
+
+// Bit-vector engine.
+//
+// GEN/KILL/IN/OUT live in flat word slabs (instruction k owns words
+// [k * words, (k + 1) * words)), bit v standing for the value with dense
+// index v of the function's L2::VarIndex (see genkill.h).
+//
+// Liveness is the backward may problem GEN/KILL over the blocks, with the
+// block summaries solved first and the instruction sets expanded after.
+// With forest the blocks are solved in two passes over the loop-nesting
+// forest, unless the CFG is irreducible, and by iteration otherwise.
+typedef L2::BitLattice<L2::Union> LiveBits;
+
+void liveness_analyze_bitvector(L2::Function *func, bool forest, L2::Writer & os, LivenessStats *stats) {
+  int n = func->instructions.size();
+
+  auto genkill_start = std::chrono::steady_clock::now();
+  L2::VarIndex vars;
+  L2::build_var_index(&vars, func);
+  int words = L2::bv_words(vars.size());
+  LiveBits l(words);
+
+  LiveBits::Store GEN = l.make(n), KILL = l.make(n);
   for (int k = 0; k < n; k++) {
-    cout << "(";
-    for (auto reg : OUT[k]) {
-        cout << reg << " ";
+    L2::gen_gen_kill_bits(l.at(GEN, k), l.at(KILL, k), func, k, vars);
+  }
+  stats->genkill = seconds_since(genkill_start);
+
+  L2::CFG cfg;
+  L2::build_cfg(&cfg, func);
+  int B = cfg.size();
+  stats->blocks = B;
+
+  LiveBits::Store BGEN = l.make(B), BKILL = l.make(B);
+  L2::summarize<L2::BACKWARD>(cfg, l, GEN, KILL, BGEN, BKILL);
+
+  LiveBits::Store BIN = l.make(B), BOUT = l.make(B);
+  std::vector<int64_t> visits;
+  L2::LoopForest loops;
+  if (forest && L2::build_loop_forest(&loops, cfg)) {
+    L2::solve_loops(cfg, loops, l, L2::GenKill<LiveBits>{BGEN, BKILL}, BIN, BOUT, &visits);
+    stats->visits = visits[0];
+    stats->forest = loops.loops();
+  } else {
+    L2::solve<L2::BACKWARD>(cfg, l, L2::GenKill<LiveBits>{BGEN, BKILL}, BIN, BOUT, &visits, &stats->steady);
+    count_visits(stats, cfg, visits);
+    stats->irreducible = forest;
+  }
+
+  LiveBits::Store IN = l.make(n), OUT = l.make(n);
+  L2::expand<L2::BACKWARD>(cfg, l, L2::GenKill<LiveBits>{GEN, KILL}, BIN, BOUT, IN, OUT);
+  stats->sets = (IN.capacity() + OUT.capacity()) * sizeof(L2::word_t);
+
+  // print in & out
+  os << "(\n(in\n";
+  print_bits(os, IN, n, words, vars);
+  os << ")\n\n(out\n";
+  print_bits(os, OUT, n, words, vars);
+  os << ")\n\n)\n";
+}
+
+// Hybrid engine: the bit-vector engine's problem over L2::LiveSet, so each
+// set is a short sorted id list or a bit-vector depending on how many values
+// it holds.
+void liveness_analyze_hybrid(L2::Function *func, L2::Writer & os, LivenessStats *stats) {
+  int n = func->instructions.size();
+
+  auto genkill_start = std::chrono::steady_clock::now();
+  L2::VarIndex vars;
+  L2::build_var_index(&vars, func);
+  int words = L2::bv_words(vars.size());
+  L2::LiveSetLattice l(words);
+
+  L2::LiveSetLattice::Store GEN = l.make(n), KILL = l.make(n);
+  std::vector<L2::word_t> gen(words), kill(words);
+  for (int k = 0; k < n; k++) {
+    L2::bv_clear(&gen[0], words);
+    L2::bv_clear(&kill[0], words);
+    L2::gen_gen_kill_bits(&gen[0], &kill[0], func, k, vars);
+    GEN[k].assign(&gen[0]);
+    KILL[k].assign(&kill[0]);
+  }
+  stats->genkill = seconds_since(genkill_start);
+
+  L2::CFG cfg;
+  L2::build_cfg(&cfg, func);
+  int B = cfg.size();
+  stats->blocks = B;
+
+  L2::LiveSetLattice::Store BGEN = l.make(B), BKILL = l.make(B);
+  L2::summarize<L2::BACKWARD>(cfg, l, GEN, KILL, BGEN, BKILL);
+
+  L2::LiveSetLattice::Store BIN = l.make(B), BOUT = l.make(B);
+  std::vector<int64_t> visits;
+  L2::solve<L2::BACKWARD>(cfg, l, L2::GenKill<L2::LiveSetLattice>{BGEN, BKILL}, BIN, BOUT, &visits, &stats->steady);
+  count_visits(stats, cfg, visits);
+
+  L2::LiveSetLattice::Store IN = l.make(n), OUT = l.make(n);
+  L2::expand<L2::BACKWARD>(cfg, l, L2::GenKill<L2::LiveSetLattice>{GEN, KILL}, BIN, BOUT, IN, OUT);
+  for (int k = 0; k < n; k++) {
+    stats->sets += IN[k].bytes() + OUT[k].bytes();
+  }
+
+  // print in & out
+  os << "(\n(in\n";
+  for (int k = 0; k < n; k++) {
+    print_row(os, IN[k], vars);
+  }
+  os << ")\n\n(out\n";
+  for (int k = 0; k < n; k++) {
+    print_row(os, OUT[k], vars);
+  }
+  os << ")\n\n)\n";
+}
+
+// Query engine: builds the full result out of L2::LivenessQuery, one
+// question per value and instruction. It is far slower than solving for the
+// sets and only serves to check the query API against the other engines.
+void liveness_analyze_query(L2::Function *func, L2::Writer & os, LivenessStats *stats) {
+  int n = func->instructions.size();
+
+  auto genkill_start = std::chrono::steady_clock::now();
+  L2::LivenessQuery q(func);
+  stats->genkill = seconds_since(genkill_start);
+  stats->blocks = q.graph().size();
+  stats->sets = q.bytes();
+
+  const L2::VarIndex & vars = q.values();
+  int words = L2::bv_words(vars.size());
+  std::vector<L2::word_t> row(words);
+  auto print = [&](bool out) {
+    for (int k = 0; k < n; k++) {
+      L2::bv_clear(&row[0], words);
+      for (int v = 0; v < vars.size(); v++) {
+        if (out ? q.is_live_out(v, k) : q.is_live_in(v, k)) {
+          L2::bv_set(&row[0], v);
+        }
+      }
+      print_row(os, BitsRow{&row[0], words}, vars);
+    }
+  };
+  os << "(\n(in\n";
+  print(false);
+  os << ")\n\n(out\n";
+  print(true);
+  os << ")\n\n)\n";
+  stats->visits = q.visits();
+}
+
+// Edits replayed by -u: a random stream of the local edits an optimiser
+// makes, spill stores and loads inserted anywhere, instructions removed,
+// and operands rewritten, on the values of the function and a few spill
+// temporaries. The stream only depends on the function, so every engine
+// sees the same edits.
+const int SPILL_TEMPORARIES = 4;
+
+std::string spill_name(int t) {
+  return "spill" + std::to_string(t);
+}
+
+L2::Edit random_edit(L2::Function *func, std::mt19937 & rng) {
+  int n = func->instructions.size();
+  auto value = [&]() {
+    for (int tries = 0; tries < 8 && n > 0 && rng() % 4 != 0; tries++) {
+      const L2::Instruction & i = func->instructions[rng() % n];
+      for (int t = 0; t < i.size; t++) {
+        if (L2::is_live_item(i.items[t])) {
+          return i.items[t];
+        }
+      }
+    }
+    return L2::Item::make(L2::Item::VAR_TAG, func->symbols->id(spill_name(rng() % SPILL_TEMPORARIES)));
+  };
+  auto slot = [&]() {
+    return L2::Item::make(L2::Item::NUMBER_TAG, 8 * (rng() % 8));
+  };
+  auto control = [&](int k) {
+    int type = func->instructions[k].type;
+    return type == L2::INS::LABEL_INS || type == L2::INS::GOTO || type == L2::INS::CJUMP || type == L2::INS::RETURN;
+  };
+
+  L2::Edit e = {};
+  e.kind = L2::EDIT::INSERT;
+  e.k = rng() % (n + 1);
+  int kind = rng() % 4;
+  if (kind >= 2 && e.k < n && !control(e.k)) {
+    if (kind == 2 && n > 1) {
+      e.kind = L2::EDIT::REMOVE;
+      return e;
+    }
+    // Rewrite one operand that holds a value; the form, and so what it
+    // reads and writes, stays the same.
+    e.i = func->instructions[e.k];
+    e.d = func->useDefs[e.k];
+    for (int t = 0; t < e.i.size; t++) {
+      if (L2::is_live_item(e.i.items[t])) {
+        e.kind = L2::EDIT::REPLACE;
+        e.i.items[t] = value();
+        return e;
+      }
+    }
+    e.i = {};
+  }
+  L2::Item rsp = L2::Item::make(L2::Item::REGISTER_TAG, L2::SYMBOL::RSP);
+  if (kind % 2 == 0) { // ((mem rsp M) <- x)
+    e.i.type = L2::INS::MEM_START;
+    e.i.push(rsp);
+    e.i.push(slot());
+    e.i.push(value());
+    e.d = L2::UseDef{L2::item_bit(2), 0, 0, 0};
+  } else {             // (x <- (mem rsp M))
+    e.i.type = L2::INS::W_START;
+    e.i.push(value());
+    e.i.push(rsp);
+    e.i.push(slot());
+    e.d = L2::UseDef{0, L2::item_bit(0), 0, 0};
+  }
+  e.i.op = L2::OP::MOVE;
+  return e;
+}
+
+void replay_edits(L2::Function *func, int edits) {
+  std::mt19937 rng(1);
+  for (int j = 0; j < edits; j++) {
+    L2::apply_edit(func, random_edit(func, rng));
+  }
+}
+
+// Incremental engine: replays the -u edits through L2::IncrementalLiveness,
+// asking after each one whether a value is live out of the edited
+// instruction, then prints the sets of the edited function. Values the
+// edits introduce are numbered after the others, so rows are sorted by name
+// when printed.
+void liveness_analyze_incremental(L2::Function *func, int edits, L2::Writer & os, LivenessStats *stats) {
+  auto solve_start = std::chrono::steady_clock::now();
+  L2::IncrementalLiveness live(func);
+  stats->solve = seconds_since(solve_start);
+
+  // Edits that rebuild the CFG cost a full solve; only the others are
+  // timed.
+  std::mt19937 rng(1), pick(2);
+  for (int j = 0; j < edits; j++) {
+    L2::Edit e = random_edit(func, rng);
+    int64_t solves = live.solves();
+    auto edit_start = std::chrono::steady_clock::now();
+    live.update(e);
+    int k = std::min(e.k, (int)func->instructions.size() - 1);
+    if (k >= 0) {
+      live.is_live_out(pick() % live.values().size(), k);
+    }
+    if (live.solves() == solves) {
+      stats->edit += seconds_since(edit_start);
+      stats->edits++;
     }
-    cout << ")\n";
   }
-  cout << ")\n\n)";
+  stats->solves = live.solves();
+  stats->visits = live.visits();
+
+  const L2::VarIndex & vars = live.values();
+  std::vector<int> rank(vars.size());
+  std::vector<int> order(vars.size());
+  for (int v = 0; v < vars.size(); v++) {
+    order[v] = v;
+  }
+  std::sort(order.begin(), order.end(), [&](int a, int b) {
+    return vars.names[a] < vars.names[b];
+  });
+  for (int r = 0; r < vars.size(); r++) {
+    rank[order[r]] = r;
+  }
+
+  int n = func->instructions.size();
+  L2::IncrementalLiveness::Lattice::Store IN, OUT;
+  live.sets(IN, OUT);
+  stats->blocks = live.graph().size();
+  stats->sets = (IN.capacity() + OUT.capacity()) * sizeof(L2::word_t);
+  const L2::IncrementalLiveness::Lattice & l = live.lattice();
+  std::vector<int> row;
+  auto print = [&](const L2::IncrementalLiveness::Lattice::Store & rows) {
+    for (int k = 0; k < n; k++) {
+      row.clear();
+      L2::bv_for_each(l.at(rows, k), l.words, [&](int v) {
+        row.push_back(v);
+      });
+      std::sort(row.begin(), row.end(), [&](int a, int b) {
+        return rank[a] < rank[b];
+      });
+      const char *sep = "";
+      os << '(';
+      for (auto v : row) {
+        os << sep << vars.names[v];
+        sep = " ";
+      }
+      os << ")\n";
+    }
+  };
+  os << "(\n(in\n";
+  print(IN);
+  os << ")\n\n(out\n";
+  print(OUT);
+  os << ")\n\n)\n";
+}
+
+// Range engine: block liveness as in the bit-vector engine, solved one
+// strongly connected component at a time, sinks first, and each block's
+// sets turned into live ranges as soon as its component is final. The block
+// rows come from a pool: entering a component takes GEN, KILL, IN and OUT
+// rows for its blocks, leaving it gives back all but IN, and IN[b] goes back
+// once the last predecessor of b outside its component has read it. So the
+// rows held at any time are those of one component and the IN sets on the
+// frontier between finished and unfinished blocks, instead of four per
+// block. GEN and KILL of an instruction are rebuilt whenever they are
+// needed.
+void build_live_ranges(L2::LiveRanges *r, L2::Function *func, const L2::VarIndex & vars, LivenessStats *stats) {
+  int V = vars.size();
+  int words = L2::bv_words(V);
+
+  L2::CFG cfg;
+  L2::build_cfg(&cfg, func);
+  int B = cfg.size();
+  stats->blocks = B;
+
+  std::vector<L2::word_t> gen(words), kill(words);
+  auto gen_kill = [&](int k) {
+    L2::bv_clear(&gen[0], words);
+    L2::bv_clear(&kill[0], words);
+    L2::gen_gen_kill_bits(&gen[0], &kill[0], func, k, vars);
+  };
+
+  typedef L2::BitRowLattice<L2::Union> Rows;
+  Rows l(words);
+  L2::RowPool pool(words);
+  Rows::Store BGEN = l.make(B), BKILL = l.make(B), BIN = l.make(B), BOUT = l.make(B);
+  std::vector<int> readers(B, 0); // predecessors in other components yet to read IN[b]
+  for (int b = 0; b < B; b++) {
+    for (int e = cfg.predStart[b]; e < cfg.predStart[b + 1]; e++) {
+      readers[b] += cfg.sccOf[cfg.pred[e]] != cfg.sccOf[b];
+    }
+  }
+
+  // A block is walked last to first, so its positions come in decreasing
+  // order. The range of v being grown is [first[v], last[v]] (first[v] < 0
+  // if none); it is closed as soon as v is found live at any position but
+  // first[v] - 1. The blocks of a component are walked last to first too,
+  // so a range only breaks where the walk jumps from one component to a
+  // block that does not come right before; ranges[v] is sorted, and the
+  // pieces of a range joined again, at the end.
+  std::vector<std::vector<L2::Range>> ranges(V);
+  std::vector<int> first(V, -1), last(V);
+  std::vector<L2::word_t> live(words);
+  auto extend = [&](int p) {
+    L2::bv_for_each(&live[0], words, [&](int v) {
+      if (first[v] != p + 1) {
+        if (first[v] >= 0) {
+          ranges[v].push_back(L2::Range{first[v], last[v]});
+        }
+        last[v] = p;
+      }
+      first[v] = p;
+    });
+  };
+  auto walk = [&](int b) {
+    L2::bv_copy(&live[0], BOUT[b], words);
+    for (int k = cfg.start[b + 1] - 1; k >= cfg.start[b]; k--) {
+      extend(2 * k + 1);
+      gen_kill(k);
+      L2::bv_transfer(&live[0], &gen[0], &live[0], &kill[0], words);
+      extend(2 * k);
+    }
+  };
+
+  auto enter = [&](int c) {
+    auto genkill_start = std::chrono::steady_clock::now();
+    for (int i = cfg.sccStart[c]; i < cfg.sccStart[c + 1]; i++) {
+      int b = cfg.sccBlock[i];
+      BGEN[b] = pool.take();
+      BKILL[b] = pool.take();
+      BIN[b] = pool.take();
+      BOUT[b] = pool.take();
+      for (int k = cfg.start[b + 1] - 1; k >= cfg.start[b]; k--) {
+        gen_kill(k);
+        l.transfer(BGEN[b], &gen[0], BGEN[b], &kill[0]);
+        l.unite(BKILL[b], &kill[0]);
+      }
+    }
+    stats->genkill += seconds_since(genkill_start);
+  };
+  auto leave = [&](int c) {
+    for (int i = cfg.sccStart[c + 1] - 1; i >= cfg.sccStart[c]; i--) {
+      int b = cfg.sccBlock[i];
+      walk(b);
+      pool.give(BGEN[b]);
+      pool.give(BKILL[b]);
+      pool.give(BOUT[b]);
+      for (int e = cfg.succStart[b]; e < cfg.succStart[b + 1]; e++) {
+        int s = cfg.succ[e];
+        if (cfg.sccOf[s] != c && --readers[s] == 0) {
+          pool.give(BIN[s]);
+        }
+      }
+      if (readers[b] == 0) {
+        pool.give(BIN[b]);
+      }
+    }
+  };
+
+  std::vector<int64_t> visits;
+  L2::solve<L2::BACKWARD>(cfg, l, L2::GenKill<Rows>{BGEN, BKILL}, BIN, BOUT, &visits, &stats->steady,
+                          L2::component_hooks(enter, leave));
+  count_visits(stats, cfg, visits);
+  stats->rows = pool.bytes();
+
+  r->rangeStart.assign(1, 0);
+  r->ranges.clear();
+  for (int v = 0; v < V; v++) {
+    if (first[v] >= 0) {
+      ranges[v].push_back(L2::Range{first[v], last[v]});
+    }
+    std::sort(ranges[v].begin(), ranges[v].end(), [](const L2::Range & a, const L2::Range & b) {
+      return a.first < b.first;
+    });
+    for (auto & g : ranges[v]) {
+      if (r->ranges.size() > (std::size_t)r->rangeStart.back() && r->ranges.back().last + 1 == g.first) {
+        r->ranges.back().last = g.last;
+      } else {
+        r->ranges.push_back(g);
+      }
+    }
+    r->rangeStart.push_back(r->ranges.size());
+    std::vector<L2::Range>().swap(ranges[v]);
+  }
+}
+
+// Prints the ranges of every value that has any, in name order:
+// "(x (first last) ...)".
+void print_ranges(L2::Writer & os, const L2::LiveRanges & r, const L2::VarIndex & vars) {
+  std::vector<int> order;
+  for (int v = 0; v < r.values(); v++) {
+    if (r.rangeStart[v] < r.rangeStart[v + 1]) {
+      order.push_back(v);
+    }
+  }
+  std::sort(order.begin(), order.end(), [&](int a, int b) {
+    return vars.names[a] < vars.names[b];
+  });
+  os << "(\n";
+  for (auto v : order) {
+    os << '(' << vars.names[v];
+    for (int i = r.rangeStart[v]; i < r.rangeStart[v + 1]; i++) {
+      os << " (" << std::to_string(r.ranges[i].first) << ' ' << std::to_string(r.ranges[i].last) << ')';
+    }
+    os << ")\n";
+  }
+  os << ")\n";
+}
+
+// Prints the usual in/out result of a function of n instructions from its
+// ranges. Each row is rebuilt when it is printed by sweeping the positions
+// with the set of ranges covering the current one: the IN rows are the even
+// positions, the OUT rows the odd ones.
+void print_ranges_as_sets(L2::Writer & os, const L2::LiveRanges & r, int n, const L2::VarIndex & vars) {
+  int words = L2::bv_words(vars.size());
+  std::vector<std::pair<int, int>> starts, ends; // (position, value)
+  for (int v = 0; v < r.values(); v++) {
+    for (int i = r.rangeStart[v]; i < r.rangeStart[v + 1]; i++) {
+      starts.push_back(std::make_pair(r.ranges[i].first, v));
+      ends.push_back(std::make_pair(r.ranges[i].last, v));
+    }
+  }
+  std::sort(starts.begin(), starts.end());
+  std::sort(ends.begin(), ends.end());
+
+  std::vector<L2::word_t> live(words);
+  os << "(\n(in\n";
+  for (int parity = 0; parity < 2; parity++) {
+    if (parity == 1) {
+      os << ")\n\n(out\n";
+    }
+    L2::bv_clear(&live[0], words);
+    std::size_t s = 0, e = 0;
+    for (int p = 0; p < 2 * n; p++) {
+      for (; s < starts.size() && starts[s].first == p; s++) {
+        L2::bv_set(&live[0], starts[s].second);
+      }
+      if (p % 2 == parity) {
+        print_row(os, BitsRow{&live[0], words}, vars);
+      }
+      for (; e < ends.size() && ends[e].first == p; e++) {
+        L2::bv_reset(&live[0], ends[e].second);
+      }
+    }
+  }
+  os << ")\n\n)\n";
+}
+
+// With ranges the live ranges themselves are printed, otherwise the
+// per-instruction sets derived from them.
+void liveness_analyze_ranges(L2::Function *func, bool ranges, L2::Writer & os, LivenessStats *stats) {
+  L2::VarIndex vars;
+  L2::build_var_index(&vars, func);
+
+  L2::LiveRanges r;
+  build_live_ranges(&r, func, vars, stats);
+  stats->sets = r.bytes();
+
+  if (ranges) {
+    print_ranges(os, r, vars);
+  } else {
+    print_ranges_as_sets(os, r, func->instructions.size(), vars);
+  }
+}
+
+// What is printed for every function: its liveness, its live ranges (-r) or
+// its reaching definitions (-d).
+enum REPORT {
+  LIVENESS, RANGES, REACHING
+};
+
+// Reaching definitions: the forward may problem GEN/KILL over the same CFG.
+// A definition is one value written by one instruction (a call defines every
+// register it clobbers); they are numbered in instruction order, and in
+// dense index order within an instruction, and an instruction kills every
+// definition of the values it writes.
+void reaching_analyze(L2::Function *func, L2::Writer & os, LivenessStats *stats) {
+  int n = func->instructions.size();
+
+  auto genkill_start = std::chrono::steady_clock::now();
+  L2::VarIndex vars;
+  L2::build_var_index(&vars, func);
+  int words = L2::bv_words(vars.size());
+
+  std::vector<int> defStart(n + 1), defInstruction, defValue;
+  std::vector<std::vector<int>> defsOf(vars.size());
+  std::vector<L2::word_t> gen(words), kill(words);
+  for (int k = 0; k < n; k++) {
+    L2::bv_clear(&gen[0], words);
+    L2::bv_clear(&kill[0], words);
+    L2::gen_gen_kill_bits(&gen[0], &kill[0], func, k, vars);
+    defStart[k] = defValue.size();
+    L2::bv_for_each(&kill[0], words, [&](int v) {
+      defsOf[v].push_back(defValue.size());
+      defInstruction.push_back(k);
+      defValue.push_back(v);
+    });
+  }
+  defStart[n] = defValue.size();
+
+  LiveBits l(L2::bv_words(defValue.size()));
+  LiveBits::Store GEN = l.make(n), KILL = l.make(n);
+  for (int k = 0; k < n; k++) {
+    for (int d = defStart[k]; d < defStart[k + 1]; d++) {
+      L2::bv_set(l.at(GEN, k), d);
+      for (auto e : defsOf[defValue[d]]) {
+        L2::bv_set(l.at(KILL, k), e);
+      }
+    }
+  }
+  stats->genkill = seconds_since(genkill_start);
+
+  L2::CFG cfg;
+  L2::build_cfg(&cfg, func);
+  int B = cfg.size();
+  stats->blocks = B;
+
+  LiveBits::Store BGEN = l.make(B), BKILL = l.make(B);
+  L2::summarize<L2::FORWARD>(cfg, l, GEN, KILL, BGEN, BKILL);
+
+  LiveBits::Store BIN = l.make(B), BOUT = l.make(B);
+  std::vector<int64_t> visits;
+  L2::solve<L2::FORWARD>(cfg, l, L2::GenKill<LiveBits>{BGEN, BKILL}, BIN, BOUT, &visits, &stats->steady);
+  count_visits(stats, cfg, visits);
+
+  LiveBits::Store IN = l.make(n), OUT = l.make(n);
+  L2::expand<L2::FORWARD>(cfg, l, L2::GenKill<LiveBits>{GEN, KILL}, BIN, BOUT, IN, OUT);
+  stats->sets = (IN.capacity() + OUT.capacity()) * sizeof(L2::word_t);
+
+  // print in & out, a definition as "name@instruction"
+  auto print = [&](const LiveBits::Store & rows) {
+    for (int k = 0; k < n; k++) {
+      const char *sep = "";
+      os << '(';
+      L2::bv_for_each(l.at(rows, k), l.words, [&](int d) {
+        os << sep << vars.names[defValue[d]] << '@' << std::to_string(defInstruction[d]);
+        sep = " ";
+      });
+      os << ")\n";
+    }
+  };
+  os << "(\n(in\n";
+  print(IN);
+  os << ")\n\n(out\n";
+  print(OUT);
+  os << ")\n\n)\n";
+}
+
+// Runs the selected engine on one function, after the -u edits, and prints
+// the selected report to os; the -s counters go to err.
+void analyze_function(L2::Function *f, const std::string & engine, REPORT report, int edits, bool stats, L2::Writer & os, std::ostream & err) {
+  LivenessStats s;
+  bool incremental = report == REPORT::LIVENESS && engine == "incremental";
+  if (!incremental) {
+    replay_edits(f, edits);
+  }
+  if (incremental) {
+    liveness_analyze_incremental(f, edits, os, &s);
+  } else if (report == REPORT::REACHING) {
+    reaching_analyze(f, os, &s);
+  } else if (report == REPORT::RANGES || engine == "interval") {
+    liveness_analyze_ranges(f, report == REPORT::RANGES, os, &s);
+  } else if (engine == "set") {
+    liveness_analyze_set(f, os, &s);
+  } else if (engine == "hybrid") {
+    liveness_analyze_hybrid(f, os, &s);
+  } else if (engine == "query") {
+    liveness_analyze_query(f, os, &s);
+  } else {
+    liveness_analyze_bitvector(f, engine == "forest", os, &s);
+  }
+  if (stats) {
+    err << ":" << f->name << " " << f->instructions.size() << " instructions, "
+        << s.blocks << " blocks, " << s.visits << " node visits, gen/kill " << s.genkill << " s, sets "
+        << s.sets / 1024 << " kB" << std::endl;
+    if (s.sccs > 0) {
+      err << "  " << s.sccs << " SCCs, " << s.loops.size() << " cyclic" << std::endl;
+    }
+    if (s.forest >= 0) {
+      err << "  loop forest, " << s.forest << " loops" << std::endl;
+    }
+    if (s.irreducible) {
+      err << "  irreducible CFG, iterated" << std::endl;
+    }
+    if (s.rows >= 0) {
+      err << "  block rows " << s.rows / 1024 << " kB at most" << std::endl;
+    }
+    if (s.steady >= 0) {
+      err << "  " << s.steady << " heap allocations in visits that changed nothing" << std::endl;
+    }
+    if (s.edits > 0) {
+      err << "  " << s.edits << " local edits, full solve " << s.solve * 1e3 << " ms, edit and query "
+          << s.edit / s.edits * 1e6 << " us on average, " << s.solves - 1 << " edits rebuilt" << std::endl;
+    }
+    for (std::size_t c = 0; c < s.loops.size(); c++) {
+      err << "  cyclic SCC " << c << ": " << s.loops[c].first << " blocks, " << s.loops[c].second << " visits" << std::endl;
+    }
+  }
+}
+
+// Analyses the functions on a fixed pool of workers. Workers claim the next
+// function from a shared counter and buffer its output; the calling thread
+// writes the buffers out in source order as soon as each one is complete,
+// so the result is identical to a sequential run.
+void analyze_parallel(L2::Program & p, int jobs, const std::string & engine, REPORT report, int edits, bool stats, L2::Writer & os) {
+  int n = p.functions.size();
+  std::vector<std::string> out(n), err(n);
+  std::vector<bool> done(n, false);
+  std::mutex m;
+  std::condition_variable cv;
+  std::atomic<int> next(0);
+
+  std::vector<std::thread> workers;
+  for (int j = 0; j < jobs; j++) {
+    workers.push_back(std::thread([&]() {
+      for (int i = next++; i < n; i = next++) {
+        L2::Writer ws;
+        std::ostringstream es;
+        analyze_function(p.functions[i], engine, report, edits, stats, ws, es);
+        std::lock_guard<std::mutex> lock(m);
+        out[i] = ws.take();
+        err[i] = es.str();
+        done[i] = true;
+        cv.notify_one();
+      }
+    }));
+  }
+
+  for (int i = 0; i < n; i++) {
+    std::string o, e;
+    {
+      std::unique_lock<std::mutex> lock(m);
+      cv.wait(lock, [&]() { return done[i]; });
+      o.swap(out[i]);
+      e.swap(err[i]);
+    }
+    os << o;
+    std::cerr << e;
+  }
+
+  for (auto & w : workers) {
+    w.join();
+  }
 }
 
 int main(int argc, char **argv) {
-  bool verbose;
+  bool stats = false;
+  bool program = false;
+  REPORT report = REPORT::LIVENESS;
+  int jobs = 1;
+  int edits = 0;
+  L2::INPUT input = L2::INPUT::AUTO;
+  std::string engine = "bitvector";
+  bool engineGiven = false;
 
   /* Check the input */
   if( argc < 2 ) {
-  std::cerr << "Usage: " << argv[ 0 ] << " SOURCE [-v]" << std::endl;
+  std::cerr << "Usage: " << argv[ 0 ] << " SOURCE... [-p] [-s] [-j N] [-m auto|read|mmap] [-r] [-d] [-e set|bitvector|hybrid|interval|forest|query|incremental] [-u EDITS]" << std::endl;
     return 1;
   }
   int32_t opt;
-  while ((opt = getopt(argc, argv, "v")) != -1) {
+  while ((opt = getopt(argc, argv, "psrdj:m:e:u:")) != -1) {
     switch (opt) {
-      case 'v':
-        verbose = true;
+      case 'p':
+        program = true;
+        break;
+
+      case 's':
+        stats = true;
+        break;
+
+      case 'r':
+        report = REPORT::RANGES;
+        break;
+
+      case 'd':
+        report = REPORT::REACHING;
+        break;
+
+      case 'j':
+        jobs = std::atoi(optarg);
+        if (jobs < 1) {
+          std::cerr << "Invalid job count: " << optarg << std::endl;
+          return 1;
+        }
+        break;
+
+      case 'u':
+        edits = std::atoi(optarg);
+        if (edits < 0) {
+          std::cerr << "Invalid edit count: " << optarg << std::endl;
+          return 1;
+        }
+        break;
+
+      case 'm':
+        if (std::string(optarg) == "auto") {
+          input = L2::INPUT::AUTO;
+        } else if (std::string(optarg) == "read") {
+          input = L2::INPUT::READ;
+        } else if (std::string(optarg) == "mmap") {
+          input = L2::INPUT::MMAP;
+        } else {
+          std::cerr << "Unknown input mode: " << optarg << std::endl;
+          return 1;
+        }
+        break;
+
+      case 'e':
+        engine = optarg;
+        engineGiven = true;
+        if (engine != "set" && engine != "bitvector" && engine != "hybrid" && engine != "interval" && engine != "forest" && engine != "query"
+            && engine != "incremental") {
+          std::cerr << "Unknown engine: " << engine << std::endl;
+          return 1;
+        }
         break;
 
       default:
-        std::cerr << "Usage: " << argv[ 0 ] << "[-v] SOURCE" << std::endl;
+        std::cerr << "Usage: " << argv[ 0 ] << " [-p] [-s] [-j N] [-m auto|read|mmap] [-r] [-d] [-e set|bitvector|hybrid|interval|forest|query|incremental] [-u EDITS] SOURCE..." << std::endl;
         return 1;
     }
   }
 
-  L2::Program p = L2::L2_parse_func_file(argv[optind]);
+  // -r and -d have a single implementation each, so an engine cannot apply.
+  if (engineGiven && report != REPORT::LIVENESS) {
+    std::cerr << "-e selects a liveness engine and cannot be combined with -r or -d" << std::endl;
+    std::cerr << "Usage: " << argv[ 0 ] << " [-p] [-s] [-j N] [-m auto|read|mmap] [-r] [-d] [-e set|bitvector|hybrid|interval|forest|query|incremental] [-u EDITS] SOURCE..." << std::endl;
+    return 1;
+  }
 
-  for (auto f : p.functions) {
-    liveness_analyze(f);
+  // All liveness output goes through one buffered writer on stdout.
+  L2::Writer out(STDOUT_FILENO);
+
+  // Every SOURCE is parsed, analysed and released in turn, so a batch run
+  // only ever holds the IR of one program.
+  for (int source = optind; source < argc; source++) {
+    auto parse_start = std::chrono::steady_clock::now();
+    L2::Program p;
+    try {
+      p = program ? L2::L2_parse_file(argv[source], input) : L2::L2_parse_func_file(argv[source], input);
+    } catch (const std::exception & e) {
+      out.flush();
+      std::cerr << e.what() << std::endl;
+      return 1;
+    }
+    if (stats) {
+      std::chrono::duration<double> parse_time = std::chrono::steady_clock::now() - parse_start;
+      std::cerr << "parse " << parse_time.count() << " s, IR " << p.arena->size() / 1024 << " kB" << std::endl;
+    }
+    // The edits only look the spill temporaries up, and each inserts at
+    // most one instruction, into room made for it here, so workers never
+    // allocate from the arena.
+    for (int t = 0; edits > 0 && t < SPILL_TEMPORARIES; t++) {
+      p.symbols->intern(spill_name(t));
+    }
+    for (auto f : p.functions) {
+      if (edits > 0) {
+        f->instructions.reserve(f->instructions.size() + edits);
+        f->useDefs.reserve(f->useDefs.size() + edits);
+      }
+    }
+
+    if (jobs > 1) {
+      analyze_parallel(p, jobs, engine, report, edits, stats, out);
+    } else {
+      for (auto f : p.functions) {
+        analyze_function(f, engine, report, edits, stats, out, std::cerr);
+      }
+    }
   }
 
+  if (stats) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    std::cerr << "peak RSS " << usage.ru_maxrss << " kB" << std::endl;
+  }
+
+  out.flush();
+  if (out.error() != 0) {
+    std::cerr << "error writing the output: " << std::strerror(out.error()) << std::endl;
+    return 1;
+  }
   return 0;
 }
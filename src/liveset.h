@@ -0,0 +1,343 @@
+// by: Zhiping
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+
+#include <bitvector.h>
+
+namespace L2 {
+
+  // Live set over the dense indices [0, words * 64) of one function that
+  // picks its own representation.
+  //
+  // Most program points keep a handful of values live, so a set starts out
+  // as a sorted vector of indices; once that would take more room than a
+  // bit-vector of the whole universe it switches to one, and back when it
+  // shrinks again. The form depends only on the size, so equal sets always
+  // share it.
+  class LiveSet {
+  public:
+    explicit LiveSet(int words = 0) : words(words) {}
+
+    bool dense() const {
+      return !bits.empty();
+    }
+
+    int size() const {
+      return count;
+    }
+
+    // Heap bytes held by the set.
+    std::size_t bytes() const {
+      return ids.capacity() * sizeof(uint32_t) + bits.capacity() * sizeof(word_t);
+    }
+
+    bool contains(uint32_t v) const {
+      if (dense()) {
+        return bv_test(&bits[0], v);
+      }
+      return std::binary_search(ids.begin(), ids.end(), v);
+    }
+
+    // this = the words bits of s.
+    void assign(const word_t *s) {
+      std::vector<word_t> t(s, s + words);
+      assign_bits(t);
+    }
+
+    void insert(uint32_t v) {
+      if (contains(v)) {
+        return;
+      }
+      if (dense()) {
+        bv_set(&bits[0], v);
+      } else {
+        ids.insert(std::lower_bound(ids.begin(), ids.end(), v), v);
+      }
+      count++;
+      normalize();
+    }
+
+    // this = gen U (out - kill); any argument may be this set itself.
+    void transfer(const LiveSet & gen, const LiveSet & out, const LiveSet & kill) {
+      update(gen, out, kill);
+    }
+
+    // The same, telling whether this changed. The new value is built once,
+    // in buffers the thread keeps across calls, and compared with this; it
+    // is only copied in if it differs, so an unchanged set costs no
+    // allocation once prepare() has sized the buffers.
+    bool update(const LiveSet & gen, const LiveSet & out, const LiveSet & kill) {
+      Scratch & t = scratch();
+      int n = gen.dense() || out.dense() ? transfer_bits(gen, out, kill, t) : transfer_ids(gen, out, kill, t);
+      bool denseResult = n > threshold();
+      if (n == count && denseResult == dense() && (denseResult ? bits == t.bits : ids == t.ids)) {
+        return false;
+      }
+      if (denseResult) {
+        bits.assign(t.bits.begin(), t.bits.end());
+        std::vector<uint32_t>().swap(ids);
+      } else {
+        ids.assign(t.ids.begin(), t.ids.end());
+        std::vector<word_t>().swap(bits);
+      }
+      count = n;
+      return true;
+    }
+
+    // Sizes the calling thread's update() buffers for sets of words words.
+    static void prepare(int words) {
+      Scratch & t = scratch();
+      t.bits.reserve(words);
+      t.ids.reserve(2 * words * (sizeof(word_t) / sizeof(uint32_t)));
+    }
+
+    // this = this U t; returns whether this grew, and only touches the heap
+    // if it did.
+    bool union_with(const LiveSet & t) {
+      if (includes(t)) {
+        return false;
+      }
+      int before = count;
+      if (dense() || t.dense() || count + t.count > threshold()) {
+        std::vector<word_t> s(words);
+        or_into(&s[0]);
+        t.or_into(&s[0]);
+        assign_bits(s);
+      } else {
+        std::vector<uint32_t> s;
+        s.reserve(count + t.count);
+        std::set_union(ids.begin(), ids.end(), t.ids.begin(), t.ids.end(), std::back_inserter(s));
+        assign_ids(s);
+      }
+      return count != before;
+    }
+
+    bool operator==(const LiveSet & t) const {
+      return count == t.count && ids == t.ids && bits == t.bits;
+    }
+
+    bool operator!=(const LiveSet & t) const {
+      return !(*this == t);
+    }
+
+    // Calls f(v) for every member v, in increasing order.
+    template< typename F >
+    void for_each(F f) const {
+      if (dense()) {
+        bv_for_each(&bits[0], words, f);
+      } else {
+        for (auto v : ids) {
+          f(v);
+        }
+      }
+    }
+
+  private:
+    bool includes(const LiveSet & t) const {
+      if (t.count > count) {
+        return false;
+      }
+      if (t.dense()) {
+        // this is at least as large, so dense too.
+        for (int w = 0; w < words; w++) {
+          if (t.bits[w] & ~bits[w]) {
+            return false;
+          }
+        }
+        return true;
+      }
+      if (!dense()) {
+        return std::includes(ids.begin(), ids.end(), t.ids.begin(), t.ids.end());
+      }
+      for (auto v : t.ids) {
+        if (!bv_test(&bits[0], v)) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    struct Scratch {
+      std::vector<word_t> bits;
+      std::vector<uint32_t> ids;
+    };
+
+    static Scratch & scratch() {
+      static thread_local Scratch t;
+      return t;
+    }
+
+    // gen U (out - kill) into t, as bits when it is dense, else as ids; at
+    // least one of gen and out is dense. Returns its size.
+    int transfer_bits(const LiveSet & gen, const LiveSet & out, const LiveSet & kill, Scratch & t) const {
+      t.bits.assign(words, 0);
+      out.or_into(&t.bits[0]);
+      if (kill.dense()) {
+        for (int w = 0; w < words; w++) {
+          t.bits[w] &= ~kill.bits[w];
+        }
+      } else {
+        for (auto v : kill.ids) {
+          bv_reset(&t.bits[0], v);
+        }
+      }
+      gen.or_into(&t.bits[0]);
+      int n = 0;
+      for (int w = 0; w < words; w++) {
+        n += __builtin_popcountll(t.bits[w]);
+      }
+      if (n <= threshold()) {
+        t.ids.clear();
+        bv_for_each(&t.bits[0], words, [&](int v) {
+          t.ids.push_back(v);
+        });
+      }
+      return n;
+    }
+
+    // The same when gen and out are both sparse: merges gen with the
+    // members of out kill lacks.
+    int transfer_ids(const LiveSet & gen, const LiveSet & out, const LiveSet & kill, Scratch & t) const {
+      t.ids.clear();
+      auto g = gen.ids.begin();
+      for (auto v : out.ids) {
+        if (kill.contains(v)) {
+          continue;
+        }
+        for (; g != gen.ids.end() && *g < v; g++) {
+          t.ids.push_back(*g);
+        }
+        if (g != gen.ids.end() && *g == v) {
+          g++;
+        }
+        t.ids.push_back(v);
+      }
+      t.ids.insert(t.ids.end(), g, gen.ids.end());
+      int n = t.ids.size();
+      if (n > threshold()) {
+        t.bits.assign(words, 0);
+        for (auto v : t.ids) {
+          bv_set(&t.bits[0], v);
+        }
+      }
+      return n;
+    }
+
+    // Largest size kept sparse: beyond it the ids outweigh the bit-vector.
+    int threshold() const {
+      return words * (int)(sizeof(word_t) / sizeof(uint32_t));
+    }
+
+    void or_into(word_t *s) const {
+      if (dense()) {
+        bv_union(s, &bits[0], words);
+      } else {
+        for (auto v : ids) {
+          bv_set(s, v);
+        }
+      }
+    }
+
+    void assign_bits(std::vector<word_t> & s) {
+      std::vector<uint32_t>().swap(ids);
+      bits.swap(s);
+      count = 0;
+      for (int w = 0; w < words; w++) {
+        count += __builtin_popcountll(bits[w]);
+      }
+      normalize();
+    }
+
+    void assign_ids(std::vector<uint32_t> & s) {
+      std::vector<word_t>().swap(bits);
+      ids.swap(s);
+      count = ids.size();
+      normalize();
+    }
+
+    void normalize() {
+      if (dense() && count <= threshold()) {
+        std::vector<uint32_t> s;
+        s.reserve(count);
+        bv_for_each(&bits[0], words, [&](int v) {
+          s.push_back(v);
+        });
+        std::vector<word_t>().swap(bits);
+        ids.swap(s);
+      } else if (!dense() && count > threshold()) {
+        bits.assign(words, 0);
+        for (auto v : ids) {
+          bv_set(&bits[0], v);
+        }
+        std::vector<uint32_t>().swap(ids);
+      }
+    }
+
+    int words;
+    int count = 0;
+    std::vector<uint32_t> ids;   // sparse form, sorted
+    std::vector<word_t> bits;    // dense form
+  };
+
+  // LiveSet as a dataflow lattice (see dataflow.h); the meet is union.
+  struct LiveSetLattice {
+    typedef std::vector<LiveSet> Store;
+    typedef LiveSet *Value;
+    typedef const LiveSet *ConstValue;
+
+    int words;
+
+    explicit LiveSetLattice(int words) : words(words) {
+      LiveSet::prepare(words);
+    }
+
+    Store make(int n) const {
+      return Store(n, LiveSet(words));
+    }
+
+    Value at(Store & s, int k) const {
+      return &s[k];
+    }
+
+    ConstValue at(const Store & s, int k) const {
+      return &s[k];
+    }
+
+    bool meet(Value s, ConstValue t) const {
+      return s->union_with(*t);
+    }
+
+    bool meet_n(Value s, const ConstValue *values, int count) const {
+      bool changed = false;
+      for (int r = 0; r < count; r++) {
+        changed = s->union_with(*values[r]) || changed;
+      }
+      return changed;
+    }
+
+    bool equal(ConstValue s, ConstValue t) const {
+      return *s == *t;
+    }
+
+    void copy(Value s, ConstValue t) const {
+      *s = *t;
+    }
+
+    void unite(Value s, ConstValue t) const {
+      s->union_with(*t);
+    }
+
+    void transfer(Value s, ConstValue gen, ConstValue in, ConstValue kill) const {
+      s->transfer(*gen, *in, *kill);
+    }
+
+    bool transfer_changed(Value s, ConstValue gen, ConstValue in, ConstValue kill) const {
+      return s->update(*gen, *in, *kill);
+    }
+  };
+}
@@ -1,8 +1,18 @@
 // by: Zhiping
 
-#include <L2.h>
+#include <map>
+#include <unordered_map>
+#include <stdexcept>
+
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include <parser.h>
+#include <registers.h>
 #include <pegtl.hh>
 #include <pegtl/analyze.hh>
+#include <pegtl/read_parser.hh>
+#include <pegtl/mmap_parser.hh>
 #include <pegtl/contrib/raw_string.hh>
 
 using namespace pegtl;
@@ -24,25 +34,45 @@ namespace L2 {
       >
     > {};
 
+  struct name_char:
+    pegtl::sor<
+      pegtl::alpha,
+      pegtl::one< '_' >,
+      pegtl::digit
+    > {};
+
+  // A keyword, unless it only starts a longer name.
+  template< char... C >
+  struct keyword:
+    pegtl::seq<
+      pegtl::string< C... >,
+      pegtl::not_at< name_char >
+    > {};
+
+  // An operator; its action records O, one of L2::OP.
+  template< int O, char... C >
+  struct op:
+    pegtl::string< C... > {};
+
   struct aop:
     pegtl::sor<
-      pegtl::string< '+', '=' >,
-      pegtl::string< '-', '=' >,
-      pegtl::string< '*', '=' >,
-      pegtl::string< '&', '=' >
+      op< OP::ADD, '+', '=' >,
+      op< OP::SUB, '-', '=' >,
+      op< OP::MUL, '*', '=' >,
+      op< OP::AND, '&', '=' >
     > {};
 
   struct sop:
     pegtl::sor<
-      pegtl::string< '<', '<', '=' >,
-      pegtl::string< '>', '>', '=' >
+      op< OP::SHL, '<', '<', '=' >,
+      op< OP::SHR, '>', '>', '=' >
     > {};
 
   struct cmp:
     pegtl::sor<
-      pegtl::string< '<', '=' >,
-      pegtl::string< '<'>,
-      pegtl::string< '=' >
+      op< OP::LESS_EQUAL, '<', '=' >,
+      op< OP::LESS, '<'>,
+      op< OP::EQUAL, '=' >
     > {};
 
   struct E:
@@ -53,32 +83,37 @@ namespace L2 {
       pegtl::one< '8' >
     > {};
 
+  // A runtime function; its action makes the operand of symbol S.
+  template< int S, char... C >
+  struct runtime:
+    keyword< C... > {};
+
   struct runtime_system_func:
     pegtl::sor<
-    pegtl::string< 'p', 'r', 'i', 'n', 't' >,
-    pegtl::string< 'a', 'l', 'l', 'o', 'c', 'a', 't', 'e' >,
-    pegtl::string< 'a', 'r', 'r', 'a', 'y', '-', 'e', 'r', 'r', 'o', 'r' >
+    runtime< SYMBOL::PRINT, 'p', 'r', 'i', 'n', 't' >,
+    runtime< SYMBOL::ALLOCATE, 'a', 'l', 'l', 'o', 'c', 'a', 't', 'e' >,
+    runtime< SYMBOL::ARRAY_ERROR, 'a', 'r', 'r', 'a', 'y', '-', 'e', 'r', 'r', 'o', 'r' >
   > {};
 
   struct mem:
-    pegtl::string < 'm', 'e', 'm' > {};
+    keyword < 'm', 'e', 'm' > {};
 
   struct inc_dec:
     pegtl::sor<
-      pegtl::string < '+', '+' >,
-      pegtl::string < '-', '-' >
+      op < OP::INC, '+', '+' >,
+      op < OP::DEC, '-', '-' >
     > {};
 
   struct call:
-    pegtl::string < 'c', 'a', 'l', 'l' > {};
+    keyword < 'c', 'a', 'l', 'l' > {};
 
   struct left_arrow:
-    pegtl::string< '<', '-' > {};
+    pegtl::sor< op< OP::MOVE, '<', '-' > > {};
 
   struct plus_minus_op:
     pegtl::sor<
-      pegtl::string< '+', '='>,
-      pegtl::string< '-', '='>
+      op< OP::ADD, '+', '='>,
+      op< OP::SUB, '-', '='>
     > {};
 
   // basic elements, definition.
@@ -142,47 +177,73 @@ namespace L2 {
       >
     > {};
 
+  // Operands. Each kind of operand is matched by a rule of its own (reg,
+  // var, N, label), and the action of that rule builds the operand.
+
+  // A register name, unless it only starts a longer name; R is its
+  // L2::SYMBOL.
+  template< int R, char... C >
+  struct reg:
+    keyword< C... > {};
+
+  struct register_name:
+    pegtl::sor<
+      reg< SYMBOL::R10, 'r', '1', '0' >, reg< SYMBOL::R11, 'r', '1', '1' >, reg< SYMBOL::R12, 'r', '1', '2' >, reg< SYMBOL::R13, 'r', '1', '3' >,
+      reg< SYMBOL::R14, 'r', '1', '4' >, reg< SYMBOL::R15, 'r', '1', '5' >, reg< SYMBOL::R8, 'r', '8' >, reg< SYMBOL::R9, 'r', '9' >,
+      reg< SYMBOL::RAX, 'r', 'a', 'x' >, reg< SYMBOL::RBP, 'r', 'b', 'p' >, reg< SYMBOL::RBX, 'r', 'b', 'x' >, reg< SYMBOL::RCX, 'r', 'c', 'x' >,
+      reg< SYMBOL::RDI, 'r', 'd', 'i' >, reg< SYMBOL::RDX, 'r', 'd', 'x' >, reg< SYMBOL::RSI, 'r', 's', 'i' >, reg< SYMBOL::RSP, 'r', 's', 'p' >
+    > {};
+
+  struct var:
+    L2_var {};
+  struct label:
+    L2_label {};
+  struct N:
+    L2_N {};
+
+  // Any register has always been accepted where a variable may stand.
   struct L2_sx:
     pegtl::sor<
-      pegtl::string< 'r', 'c', 'x' >,
-      L2_var
+      reg< SYMBOL::RCX, 'r', 'c', 'x' >,
+      register_name,
+      var
     > {};
 
   struct L2_a:
     pegtl::sor<
-      pegtl::string < 'r', 'd', 'i' >,
-      pegtl::string < 'r', 's', 'i' >,
-      pegtl::string < 'r', 'd', 'x' >,
+      reg < SYMBOL::RDI, 'r', 'd', 'i' >,
+      reg < SYMBOL::RSI, 'r', 's', 'i' >,
+      reg < SYMBOL::RDX, 'r', 'd', 'x' >,
       L2_sx,
-      pegtl::string < 'r', '8' >,
-      pegtl::string < 'r', '9' >
+      reg < SYMBOL::R8, 'r', '8' >,
+      reg < SYMBOL::R9, 'r', '9' >
     > {};
 
   struct L2_w:
     pegtl::sor<
       L2_a,
-      pegtl::string < 'r', 'a', 'x' >,
-      pegtl::string < 'r', 'b', 'x' >,
-      pegtl::string < 'r', 'b', 'p' >,
-      pegtl::string < 'r', '1', '0' >,
-      pegtl::string < 'r', '1', '1' >,
-      pegtl::string < 'r', '1', '2' >,
-      pegtl::string < 'r', '1', '3' >,
-      pegtl::string < 'r', '1', '4' >,
-      pegtl::string < 'r', '1', '5' >
+      reg < SYMBOL::RAX, 'r', 'a', 'x' >,
+      reg < SYMBOL::RBX, 'r', 'b', 'x' >,
+      reg < SYMBOL::RBP, 'r', 'b', 'p' >,
+      reg < SYMBOL::R10, 'r', '1', '0' >,
+      reg < SYMBOL::R11, 'r', '1', '1' >,
+      reg < SYMBOL::R12, 'r', '1', '2' >,
+      reg < SYMBOL::R13, 'r', '1', '3' >,
+      reg < SYMBOL::R14, 'r', '1', '4' >,
+      reg < SYMBOL::R15, 'r', '1', '5' >
     > {};
 
   struct L2_x:
     pegtl::sor<
       L2_w,
-      pegtl::string < 'r', 's', 'p' >
+      reg < SYMBOL::RSP, 'r', 's', 'p' >
     > {};
 
   struct L2_s:
     pegtl::sor<
       L2_x,
-      L2_N,
-      L2_label
+      N,
+      label
     > {};
 
   struct L2_M:
@@ -191,13 +252,13 @@ namespace L2 {
   struct L2_t:
     pegtl::sor<
       L2_x,
-      L2_N
+      N
     > {};
 
   struct L2_u:
     pegtl::sor<
       L2_w,
-      L2_label
+      label
     > {};
 
   // special elements
@@ -219,12 +280,6 @@ namespace L2 {
 
   // element decleration
 
-  struct var:
-    L2_var {};
-  struct label:
-    L2_label {};
-  struct N:
-    L2_N {};
   struct sx:
     L2_sx {};
   struct a:
@@ -257,15 +312,24 @@ namespace L2 {
       pegtl::one< ')' >
     > {};
 
-  struct stack_arg:
+  // Either (stack-arg M), like (mem x M), or plain stack-arg M.
+  struct stack_arg_M:
     pegtl::seq<
-      pegtl::one<'('>,
-      seps,
-      pegtl::string<'s', 't', 'a', 'c', 'k', '-', 'a', 'r', 'g'>,
-      seps,
-      M,
+      keyword<'s', 't', 'a', 'c', 'k', '-', 'a', 'r', 'g'>,
       seps,
-      pegtl::one<')'>
+      M
+    > {};
+
+  struct stack_arg:
+    pegtl::sor<
+      pegtl::seq<
+        pegtl::one<'('>,
+        seps,
+        stack_arg_M,
+        seps,
+        pegtl::one<')'>
+      >,
+      stack_arg_M
     > {};
 
   struct ins_w_start:
@@ -277,14 +341,14 @@ namespace L2 {
           left_arrow,
           seps,
           pegtl::sor<
-            pegtl::seq<
-              s, // potential bug
-              pegtl::star< pegtl::seq< seps, cmp, seps, t > >
-            >,
+            stack_arg, // before s, which would take the stack of stack-arg as a variable
             mem_x_M,
-            stack_arg
+            pegtl::seq<
+              s,
+              pegtl::opt< pegtl::seq< seps, cmp, seps, t > >
+            >
           >
-        >, // potential bug
+        >,
         pegtl::seq<
           aop,
           seps,
@@ -309,7 +373,7 @@ namespace L2 {
   struct ins_cjump:
     pegtl::seq<
       seps,
-      pegtl::string< 'c', 'j', 'u', 'm', 'p' >,
+      keyword< 'c', 'j', 'u', 'm', 'p' >,
       seps,
       t,
       seps,
@@ -326,16 +390,16 @@ namespace L2 {
     label {};
 
   struct ins_goto:
-    pegtl::seq< pegtl::string < 'g', 'o', 't', 'o' >, seps, label > {};
+    pegtl::seq< keyword < 'g', 'o', 't', 'o' >, seps, label > {};
 
   struct ins_return:
-    pegtl::seq< pegtl::string < 'r', 'e', 't', 'u', 'r', 'n' > > {};
+    pegtl::seq< keyword < 'r', 'e', 't', 'u', 'r', 'n' > > {};
 
   struct ins_call_func:
     pegtl::seq<
       call,
       seps,
-      pegtl::sor< u, runtime_system_func >,
+      pegtl::sor< runtime_system_func, u >,
       seps,
       N
     > {};
@@ -410,35 +474,114 @@ namespace L2 {
    * Helpers
    */
 
-  Item * new_item(std::string str) {
-   Item *item = new Item();
-   if (str[0] == ':') { // label
-     item->type = L2::ITEM::LABEL;
-     str.erase(0, 1);  // remove ":"
-     item->name = str;
-   } else if (str[0] == 'r') { // register
-     item->type = L2::ITEM::REGISTER;
-     item->name = str;
-     item->value = -1;
-   } else {
-     try { // number
-       item->value = std::stoi(str);
-       item->type = L2::ITEM::NUMBER;
-     } catch(const std::exception& e) { // var
-       item->type = L2::ITEM::VAR;
-      //  str.erase(0, 1);
-       item->name = str;
-       item->value = -1;
-     }
+  // The rows of the function being parsed. They are collected in buffers
+  // reused from one function to the next and copied into the arena in one
+  // piece once the function is complete, so the function's rows are sized
+  // exactly and nothing is left behind by their growing.
+  struct FunctionRows {
+    std::vector<Instruction> instructions;
+    std::vector<UseDef> useDefs;
+    std::vector<int64_t> numbers;
+
+    int64_t value_of(Item i) const {
+      return i.tag() == Item::POOLED_NUMBER_TAG ? numbers[i.payload()] : i.immediate();
+    }
+
+    void move_to(Function * f) {
+      f->instructions.assign(instructions.begin(), instructions.end());
+      f->useDefs.assign(useDefs.begin(), useDefs.end());
+      f->numbers.assign(numbers.begin(), numbers.end());
+      instructions.clear();
+      useDefs.clear();
+      numbers.clear();
+    }
+  };
+
+  Item new_number(FunctionRows & rows, int64_t value) {
+   if (value >= Item::MIN_IMMEDIATE && value <= Item::MAX_IMMEDIATE) {
+     return Item::make(Item::NUMBER_TAG, (uint32_t)value);
    }
-   return item;
+   rows.numbers.push_back(value);
+   return Item::make(Item::POOLED_NUMBER_TAG, rows.numbers.size() - 1);
   }
-  //
-  Item * new_item2(std::string reg, std::string offset) {
-   Item *item = new Item();
-   item = new_item(reg);
-   item->value = std::stoi(offset);
-   return item;
+
+  // The value of an L2_N token. Digits past 64 bits wrap around, as the
+  // immediate they stand for would.
+  int64_t parse_number(const pegtl::input & in) {
+    const char *c = in.begin(), *end = in.end();
+    bool negative = *c == '-';
+    if (*c == '-' || *c == '+') {
+      c++;
+    }
+    uint64_t value = 0;
+    for (; c < end; c++) {
+      value = value * 10 + (*c - '0');
+    }
+    return (int64_t)(negative ? 0 - value : value);
+  }
+
+  // A label token, ":name".
+  Item new_label(Program & p, const pegtl::input & in) {
+    return Item::make(Item::LABEL_TAG, p.symbols->intern(in.begin() + 1, in.end()));
+  }
+
+  // The instruction being parsed, as far as its rules have matched: the
+  // operands in source order, which is also the order of their slots in
+  // the Instruction, and the last operator seen. The operand and operator
+  // actions fill it in, and the action of the instruction rule takes it
+  // and starts the next one afresh. rows are those of the function so far.
+  struct InstructionBuilder {
+    FunctionRows rows;
+    Item items[4];
+    int count = 0;
+    uint8_t op = OP::NO_OP;
+    bool stackArg = false;
+
+    void operand(Item i) {
+      assert(count < 4);
+      items[count++] = i;
+    }
+
+    bool compares() const {
+      return op == OP::LESS || op == OP::LESS_EQUAL || op == OP::EQUAL;
+    }
+
+    Instruction take(uint8_t type) {
+      Instruction i = {};
+      i.type = type;
+      i.op = op;
+      for (int t = 0; t < count; t++) {
+        i.push(items[t]);
+      }
+      clear();
+      return i;
+    }
+
+    void clear() {
+      count = 0;
+      op = OP::NO_OP;
+      stackArg = false;
+    }
+  };
+
+  // Appends i to the function being parsed together with what it reads and
+  // writes: reads / writes name operand slots (see L2::UseDef), and the
+  // slots that turn out to hold no live value are dropped here.
+  void emit(FunctionRows & rows, const Instruction & i, uint8_t reads, uint8_t writes, regmask_t gen = 0, regmask_t kill = 0) {
+    uint8_t live = 0;
+    for (int t = 0; t < i.size; t++) {
+      if (is_live_item(i.items[t])) {
+        live |= item_bit(t);
+      }
+    }
+    rows.instructions.push_back(i);
+    rows.useDefs.push_back(UseDef{(uint8_t)(reads & live), (uint8_t)(writes & live), gen, kill});
+  }
+
+  // The slots a two-operand form reads: its source, and its destination too
+  // unless it only assigns it.
+  uint8_t update_reads(const Instruction & i, int source) {
+    return item_bit(source) | (i.op != OP::MOVE ? item_bit(0) : 0);
   }
 
   /*
@@ -449,373 +592,258 @@ namespace L2 {
 
 
   template<> struct action < prog_label > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
+    static void apply( const pegtl::input & in, L2::Program & p, InstructionBuilder & b ) {
       if (p.entryPointLabel.empty()) {
-        std::string token = in.string();
-        token.erase(0, 1);
-
-        p.entryPointLabel = token;
+        p.entryPointLabel.assign(in.begin() + 1, in.end());
       }
     }
   };
 
   template<> struct action < function_name > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
-      L2::Function *newF = new L2::Function();
-
-      std::string token = in.string();
-      token.erase(0, 1);
+    static void apply( const pegtl::input & in, L2::Program & p, InstructionBuilder & b ) {
+      L2::Function *newF = p.arena->make<L2::Function>(p.arena.get());
 
-      newF->name = token;
+      newF->name.assign(in.begin() + 1, in.end());
+      newF->symbols = p.symbols;
       p.functions.push_back(newF);
       // f->name = token;
-      v.clear();
+      b.clear();
+    }
+  };
+
+  template<> struct action < L2_function_rule > {
+    static void apply( const pegtl::input & in, L2::Program & p, InstructionBuilder & b ) {
+      b.rows.move_to(p.functions.back());
     }
   };
 
   template<> struct action < L2_label_rule > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
-      L2_item i;
-      i.labelName = in.string();
-      // parsed_registers.push_back(i);
-      v.clear();
+    static void apply( const pegtl::input & in, L2::Program & p, InstructionBuilder & b ) {
+      b.clear();
     }
   };
 
   template<> struct action < argument_number > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
+    static void apply( const pegtl::input & in, L2::Program & p, InstructionBuilder & b ) {
       L2::Function *currentF = p.functions.back();
-      currentF->arguments = std::stoll(in.string());
+      currentF->arguments = parse_number(in);
     }
   };
 
   template<> struct action < local_number > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
+    static void apply( const pegtl::input & in, L2::Program & p, InstructionBuilder & b ) {
       L2::Function *currentF = p.functions.back();
-      currentF->locals = std::stoll(in.string());
+      currentF->locals = parse_number(in);
     }
   };
 
   template<> struct action < ins_w_start > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
-      L2::Function *currentF = p.functions.back();
-      L2::Instruction *newIns = new L2::Instruction();
-
-      if (v.size() == 3) { // no mem, two op
-        newIns->type = L2::INS::W_START;
-        // cout << "tinkering no mem assign: " << v.at(0) << " " << v.at(1) << " " << v.at(2) << endl;
-        newIns->items.push_back(L2::new_item(v.at(0)));
-        newIns->items.push_back(L2::new_item(v.at(2)));
-        newIns->op = v.at(1);
-
-      } else if (v.size() == 2) { // INS_INC_DEC
-        newIns->type = L2::INS::INC_DEC;
-
-        // cout << "tinkering ins_inc_dec: " << v.at(0) << v.at(1) << endl;
-        newIns->op = v.at(1);
-        newIns->items.push_back(new_item(v.at(0)));
-      } else if (v.size() == 4) {
-        if (v.at(2) == "stack-arg") { // stack-arg
-          newIns->type = L2::INS::STACK;
-
-          newIns->items.push_back(new_item(v.at(0)));
-          newIns->items.push_back(new_item(v.at(3)));
-        } else { // CISC
-          newIns->type = L2::INS::CISC;
-
-          // cout << "tinkering CISC: " << v.at(0) << " @ " << v.at(1) << " " << v.at(2) << " " << v.at(3) << endl;
-          newIns->items.push_back(new_item(v.at(0)));
-          newIns->items.push_back(new_item(v.at(1)));
-          newIns->items.push_back(new_item2(v.at(2), v.at(3)));
-        }
-      } else if (v.at(2) == "mem") { // right mem two op
-        newIns->type = L2::INS::W_START;
-        // cout << "tinkering right mem (" << v.at(0) << " " << v.at(1) << " (" << v.at(3) << " " << v.at(4) << ")" << endl;
-        newIns->items.push_back(L2::new_item(v.at(0)));
-        newIns->items.push_back(L2::new_item2(v.at(3), v.at(4)));
-        newIns->op = v.at(1);
-      } else { // cmp, 5 cmp
-        newIns->type = L2::INS::CMP;
-
-        // cout << "tinkering cmp " << v.at(0) << " " << v.at(1) << " " << v.at(2) << " " << v.at(3) << " " << v.at(4)<< endl;
-        newIns->items.push_back(L2::new_item(v.at(0)));
-        newIns->items.push_back(L2::new_item(v.at(2)));
-        newIns->items.push_back(L2::new_item(v.at(4)));
-        newIns->op = v.at(3);
+    static void apply( const pegtl::input & in, L2::Program & p, InstructionBuilder & b ) {
+      L2::Instruction newIns;
+      uint8_t reads, writes = item_bit(0);
+
+      if (b.stackArg) { // w <- stack-arg M
+        b.op = OP::NO_OP;
+        newIns = b.take(L2::INS::STACK);
+        reads = 0;
+      } else if (b.count == 4) { // CISC, w @ w w E
+        newIns = b.take(L2::INS::CISC);
+        reads = item_bit(1) | item_bit(2);
+      } else if (b.op == OP::INC || b.op == OP::DEC) {
+        newIns = b.take(L2::INS::INC_DEC);
+        reads = item_bit(0);
+      } else if (b.compares()) { // w <- t cmp t
+        newIns = b.take(L2::INS::CMP);
+        reads = item_bit(1) | item_bit(2);
+      } else { // two op, the source possibly mem x M
+        newIns = b.take(L2::INS::W_START);
+        reads = update_reads(newIns, 1);
       }
-      currentF->instructions.push_back(newIns);
-      v.clear();
+      emit(b.rows, newIns, reads, writes);
     }
   };
 
   template<> struct action < ins_mem_start > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
-      L2::Function *currentF = p.functions.back();
-      L2::Instruction *newIns = new L2::Instruction();
-      newIns->type = L2::INS::MEM_START;
-
-      newIns->items.push_back(L2::new_item2(v.at(1), v.at(2)));
-      newIns->items.push_back(L2::new_item(v.at(4)));
-      newIns->op = v.at(3);
+    static void apply( const pegtl::input & in, L2::Program & p, InstructionBuilder & b ) {
+      L2::Instruction newIns = b.take(L2::INS::MEM_START);
 
-      currentF->instructions.push_back(newIns);
-      v.clear();
+      // The address register counts as written, as it always has here.
+      emit(b.rows, newIns, update_reads(newIns, 2), item_bit(0));
     }
   };
 
   template<> struct action < ins_cjump > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
-      L2::Function *currentF = p.functions.back();
-      L2::Instruction *newIns = new L2::Instruction();
-      newIns->type = L2::INS::CJUMP;
-
-      // cout << "tinkering cjump " << v.at(0) << " " << v.at(1) << " " << v.at(2) << " " << v.at(3) << " " << v.at(4)<< endl;
-      newIns->items.push_back(L2::new_item(v.at(0)));
-      newIns->op = v.at(1);
-      newIns->items.push_back(L2::new_item(v.at(2)));
-      newIns->items.push_back(L2::new_item(v.at(3)));
-      newIns->items.push_back(L2::new_item(v.at(4)));
-
-      currentF->instructions.push_back(newIns);
-      v.clear();
+    static void apply( const pegtl::input & in, L2::Program & p, InstructionBuilder & b ) {
+      emit(b.rows, b.take(L2::INS::CJUMP), item_bit(0) | item_bit(1), 0);
     }
   };
 
   template<> struct action < ins_call_func > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
-
-      L2::Function *currentF = p.functions.back();
-      L2::Instruction *newIns = new L2::Instruction();
-      newIns->type = L2::INS::CALL;
-
-      // cout << "tinkering " << v.at(0) << " ?? " << v.at(1) << " - " << v.at(2) << endl;
-
-      newIns->items.push_back(L2::new_item2(v.at(1), v.at(2)));
-      currentF->instructions.push_back(newIns);
-      v.clear();
+    static void apply( const pegtl::input & in, L2::Program & p, InstructionBuilder & b ) {
+      L2::Instruction newIns = b.take(L2::INS::CALL);
+      emit(b.rows, newIns, item_bit(0), 0, args_mask(b.rows.value_of(newIns.items[1])), CALL_KILL);
     }
   };
 
   template<> struct action < ins_return > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
-      L2::Function *currentF = p.functions.back();
-      L2::Instruction *newIns = new L2::Instruction();
-
-      // cout << "tinkering call return" << endl;
-
-      newIns->type = L2::INS::RETURN;
-
-      currentF->instructions.push_back(newIns);
-      v.clear();
+    static void apply( const pegtl::input & in, L2::Program & p, InstructionBuilder & b ) {
+      emit(b.rows, b.take(L2::INS::RETURN), 0, 0, RETURN_GEN);
     }
   };
 
   template<> struct action < ins_label > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
-      L2::Function *currentF = p.functions.back();
-      L2::Instruction *newIns = new L2::Instruction();
-      newIns->type = L2::INS::LABEL_INS;
-
-      L2::Item *newItem = new L2::Item();
-      newIns->items.push_back(new_item(in.string()));
-
-      // cout << "tinkering label: " << in.string() << endl;
-
-      currentF->instructions.push_back(newIns);
-      v.clear();
+    static void apply( const pegtl::input & in, L2::Program & p, InstructionBuilder & b ) {
+      b.operand(L2::new_label(p, in));
+      emit(b.rows, b.take(L2::INS::LABEL_INS), 0, 0);
     }
   };
 
   template<> struct action < ins_goto > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
-      L2::Function *currentF = p.functions.back();
-      L2::Instruction *newIns = new L2::Instruction();
-      newIns->type = L2::INS::GOTO;
-
-      L2::Item *newItem = new L2::Item();
-      newIns->items.push_back(new_item(v.at(0)));
-
-      // cout << "tinkering ins_goto: " << v.at(0) << endl;
-
-      currentF->instructions.push_back(newIns);
-      v.clear();
+    static void apply( const pegtl::input & in, L2::Program & p, InstructionBuilder & b ) {
+      emit(b.rows, b.take(L2::INS::GOTO), 0, 0);
     }
   };
 
   //
-  // Actions to collect string from rules, should be a better way.
+  // Actions to fill in the instruction being parsed. Operators and keywords
+  // are known by their rule, so none of them is kept as text.
   //
-  template<> struct action < inc_dec > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
-      v.push_back(in.string());
-      // cout << "tinkering action runtime_system_func " << in.string() << endl;
+  template< int O, char... C > struct action < op< O, C... > > {
+    static void apply( const pegtl::input & in, L2::Program & p, InstructionBuilder & b ) {
+      b.op = O;
     }
   };
 
-  template<> struct action < runtime_system_func > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
-      v.push_back(in.string());
-      // cout << "tinkering action runtime_system_func " << in.string() << endl;
+  template<> struct action < stack_arg > {
+    static void apply( const pegtl::input & in, L2::Program & p, InstructionBuilder & b ) {
+      b.stackArg = true;
     }
   };
 
-  template<> struct action < var > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
-      // cout << in.string();
-      // std::string token = in.string();
-      // token.insert(0, ".");
-      // v.push_back(token);
-      v.push_back(in.string());
-      // cout << "tinkering action call " << in.string() << endl;
+  // The registers and the runtime functions are the first symbols of every
+  // table (see L2::SYMBOL), so their ids need no lookup.
+  template< int R, char... C > struct action < reg< R, C... > > {
+    static void apply( const pegtl::input & in, L2::Program & p, InstructionBuilder & b ) {
+      b.operand(Item::make(Item::REGISTER_TAG, R));
     }
   };
 
-  template<> struct action < call > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
-      v.push_back(in.string());
-      // cout << "tinkering action call " << in.string() << endl;
-      // cout << in.string();
+  template< int S, char... C > struct action < runtime< S, C... > > {
+    static void apply( const pegtl::input & in, L2::Program & p, InstructionBuilder & b ) {
+      b.operand(Item::make(Item::VAR_TAG, S));
     }
   };
 
-  template<> struct action < cmp > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
-      v.push_back(in.string());
-      // cout << "tinkering action cmp " << in.string() << endl;
+  template<> struct action < var > {
+    static void apply( const pegtl::input & in, L2::Program & p, InstructionBuilder & b ) {
+      b.operand(Item::make(Item::VAR_TAG, p.symbols->intern(in.begin(), in.end())));
     }
   };
 
-  template<> struct action < u > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
-      v.push_back(in.string());
-      // cout << "tinkering action u " << in.string() << endl;
+  template<> struct action < label > {
+    static void apply( const pegtl::input & in, L2::Program & p, InstructionBuilder & b ) {
+      b.operand(new_label(p, in));
     }
   };
 
   template<> struct action < N > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
-      v.push_back(in.string());
-      // cout << "tinkering action N " << in.string() << endl;
-    }
-  };
-
-  template<> struct action < plus_minus_op > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
-      v.push_back(in.string());
-      // cout << "tinkering action plus_minus_op " << in.string() << endl;
-    }
-  };
-
-  template<> struct action < sx > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
-      v.push_back(in.string());
-      // cout << "tinkering action rcx " << in.string() << endl;
-    }
-  };
-
-  template<> struct action < mem > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
-      v.push_back(in.string());
-      // cout << "tinkering action mem " << in.string() << endl;
-    }
-  };
-
-  template<> struct action < t > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
-      v.push_back(in.string());
-      // cout << "tinkering action t " << in.string() << endl;
-    }
-  };
-
-  template<> struct action < w > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
-      v.push_back(in.string());
-      // cout << "tinkering action w " << in.string() << endl;
-    }
-  };
-
-  template<> struct action < left_arrow > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
-      v.push_back(in.string());
-      // cout << "tinkering action left_arrow " << in.string() << endl;
-    }
-  };
-
-  template<> struct action < s > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
-      v.push_back(in.string());
-      // cout << "tinkering action s " << in.string() << endl;
-    }
-  };
-
-  template<> struct action < x > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
-      v.push_back(in.string());
-      // cout << "tinkering action x " << in.string() << endl;
-    }
-  };
-
-  template<> struct action < aop > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
-      v.push_back(in.string());
-      // cout << "tinkering action aop " << in.string() << endl;
-    }
-  };
-
-  template<> struct action < sop > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
-      v.push_back(in.string());
-      // cout << "tinkering action sop " << in.string() << endl;
+    static void apply( const pegtl::input & in, L2::Program & p, InstructionBuilder & b ) {
+      b.operand(new_number(b.rows, parse_number(in)));
     }
   };
 
   template<> struct action < M > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
-      v.push_back(in.string());
-      // cout << "tinkering action M " << in.string() << endl;
+    static void apply( const pegtl::input & in, L2::Program & p, InstructionBuilder & b ) {
+      b.operand(new_number(b.rows, parse_number(in)));
     }
   };
 
   template<> struct action < E > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
-      v.push_back(in.string());
-      // cout << "tinkering action E " << in.string() << endl;
+    static void apply( const pegtl::input & in, L2::Program & p, InstructionBuilder & b ) {
+      b.operand(new_number(b.rows, parse_number(in)));
     }
   };
 
-  template<> struct action < label > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
-      v.push_back(in.string());
-      // cout << "tinkering action label " << in.string() << endl;
+  /*
+   * Linking: resolve every goto/cjump label operand to the index of the
+   * instruction defining that label, so later passes never look labels up
+   * by name.
+   */
+  void link_item(Item & item, std::unordered_map<uint32_t, int> & labels, Function * f) {
+    auto it = labels.find(item.payload());
+    if (it == labels.end()) {
+      throw std::runtime_error("undefined label :" + std::string(f->name_of(item).c_str()) + " in function :" + f->name.c_str());
     }
-  };
+    item = Item::make(Item::TARGET_TAG, it->second);
+  }
 
-  template<> struct action < L2_instruction > {
-    static void apply( const pegtl::input & in, L2::Program & p, std::vector<std::string> & v ) {
-      // v.push_back(in.string());
-      // cout << in.string() << "\n";
-      // cout << "tinkering action label " << in.string() << endl;
+  void link_labels(Function * f) {
+    std::unordered_map<uint32_t, int> labels;
+    for (std::size_t k = 0; k < f->instructions.size(); k++) {
+      Instruction & i = f->instructions[k];
+      if (i.type == L2::INS::LABEL_INS) {
+        if (!labels.insert(std::make_pair(i.items[0].payload(), (int)k)).second) {
+          throw std::runtime_error("duplicate label :" + std::string(f->name_of(i.items[0]).c_str()) + " in function :" + f->name.c_str());
+        }
+      }
     }
-  };
+    for (auto & i : f->instructions) {
+      if (i.type == L2::INS::GOTO) {
+        link_item(i.items[0], labels, f);
+      } else if (i.type == L2::INS::CJUMP) {
+        link_item(i.items[2], labels, f);
+        link_item(i.items[3], labels, f);
+      }
+    }
+  }
 
-  /*
-   * Data structures required to parse
-   */
-  std::vector< L2_item > parsed_registers;
+  bool use_mmap (char *fileName, INPUT mode) {
+    if (mode != INPUT::AUTO) {
+      return mode == INPUT::MMAP;
+    }
+    struct stat st;
+    return ::stat(fileName, &st) == 0 && st.st_size >= MMAP_THRESHOLD;
+  }
 
-  Program L2_parse_func_file (char *fileName) {
+  template< typename Rule >
+  Program parse_file (char *fileName, INPUT mode) {
     /*
      * Check the grammar for some possible issues.
      */
-    pegtl::analyze< L2::L2_function_rule >();
+    pegtl::analyze< Rule >();
     /*
      * Parse.
      */
+    // The whole file must match: a rule that stops early would leave the
+    // rest of the input unanalysed without a word.
+    typedef pegtl::seq< Rule, pegtl::eof > Whole;
     L2::Program p;
-    // L2::Instruction ti; // temp instruction
-    std::vector<std::string> v;
-    pegtl::file_parser(fileName).parse< L2::L2_function_rule, L2::action > (p, v);
+    InstructionBuilder b;
+    bool parsed;
+    if (use_mmap(fileName, mode)) {
+      // Parse straight out of the page cache; the parser only ever moves
+      // forward, so let the kernel read ahead and drop pages behind us.
+      pegtl::mmap_parser in(fileName);
+      ::madvise(const_cast< char * >(in.input().begin()), in.input().size(), MADV_SEQUENTIAL);
+      parsed = in.parse< Whole, L2::action > (p, b);
+    } else {
+      parsed = pegtl::read_parser(fileName).parse< Whole, L2::action > (p, b);
+    }
+    if (!parsed) {
+      throw std::runtime_error(std::string(fileName) + ": syntax error");
+    }
+    for (auto f : p.functions) {
+      link_labels(f);
+    }
 
     return p;
   }
+
+  Program L2_parse_func_file (char *fileName, INPUT mode) {
+    return parse_file< L2::L2_function_rule >(fileName, mode);
+  }
+
+  Program L2_parse_file (char *fileName, INPUT mode) {
+    return parse_file< L2::L2_grammer >(fileName, mode);
+  }
 }
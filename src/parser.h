@@ -1,9 +1,19 @@
 // by: Zhiping
 
-// #pragma once
+#pragma once
 
 #include <L2.h>
 
 namespace L2 {
-  Program L2_parse_func_file (char *fileName);
+
+  // How the source file is brought into memory. AUTO reads small files into
+  // a buffer and maps files of at least MMAP_THRESHOLD bytes.
+  enum INPUT {
+    AUTO, READ, MMAP
+  };
+
+  const int64_t MMAP_THRESHOLD = 1 << 20;
+
+  Program L2_parse_func_file (char *fileName, INPUT mode = INPUT::AUTO);  // a single (:f ...) function
+  Program L2_parse_file (char *fileName, INPUT mode = INPUT::AUTO);       // a whole (:main (:f ...) ...) program
 }
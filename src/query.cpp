@@ -0,0 +1,156 @@
+// by: Zhiping
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <climits>
+
+#include <query.h>
+
+namespace L2 {
+
+  // Lays (value, block) pairs out in CSR form by value, keeping the pairs of
+  // each value in the order given.
+  static void group_by_value(const std::vector<std::pair<int, int>> & pairs, int V, std::vector<int> * start, std::vector<int> * list) {
+    start->assign(V + 1, 0);
+    for (auto & p : pairs) {
+      (*start)[p.first + 1]++;
+    }
+    for (int v = 0; v < V; v++) {
+      (*start)[v + 1] += (*start)[v];
+    }
+    list->resize(pairs.size());
+    std::vector<int> fill(start->begin(), start->end() - 1);
+    for (auto & p : pairs) {
+      (*list)[fill[p.first]++] = p.second;
+    }
+  }
+
+  LivenessQuery::LivenessQuery(Function * func) {
+    build_var_index(&vars, func);
+    build_cfg(&cfg, func);
+    int V = vars.size(), B = cfg.size();
+
+    // One forward walk per block. A read is upward exposed unless the block
+    // already read or wrote the value: seen[v] is the last block that read
+    // or wrote v, wrote[v] the last block that wrote it, and readAt[v] the
+    // last instruction that read it.
+    blockOf.resize(func->instructions.size());
+    std::vector<int> seen(V, -1), wrote(V, -1), readAt(V, -1), reads, writes;
+    std::vector<std::pair<int, int>> occurrencePairs, exposedPairs, definedPairs;
+    for (int b = 0; b < B; b++) {
+      for (int k = cfg.start[b]; k < cfg.start[b + 1]; k++) {
+        blockOf[k] = b;
+        reads.clear();
+        writes.clear();
+        for_each_gen_kill(func, k, vars, [&reads](int v) {
+          reads.push_back(v);
+        }, [&writes](int v) {
+          writes.push_back(v);
+        });
+        // An instruction reads its operands before it writes its result.
+        for (auto v : reads) {
+          if (seen[v] != b) {
+            seen[v] = b;
+            exposedPairs.push_back(std::make_pair(v, b));
+          }
+          if (readAt[v] != k) {
+            readAt[v] = k;
+            occurrencePairs.push_back(std::make_pair(v, 2 * k + 1));
+          }
+        }
+        for (auto v : writes) {
+          if (wrote[v] != b) {
+            wrote[v] = b;
+            definedPairs.push_back(std::make_pair(v, b));
+          }
+          seen[v] = b;
+          if (readAt[v] != k) {
+            occurrencePairs.push_back(std::make_pair(v, 2 * k));
+          }
+        }
+      }
+    }
+    group_by_value(occurrencePairs, V, &occurrenceStart, &occurrences);
+    group_by_value(exposedPairs, V, &exposedStart, &exposed);
+    group_by_value(definedPairs, V, &definedStart, &defined);
+
+    lowestScc.assign(V, INT_MAX);
+    for (int v = 0; v < V; v++) {
+      for (int i = exposedStart[v]; i < exposedStart[v + 1]; i++) {
+        lowestScc[v] = std::min(lowestScc[v], cfg.sccOf[exposed[i]]);
+      }
+    }
+
+    mark.assign(B, 0);
+  }
+
+  bool LivenessQuery::has(const std::vector<int> & start, const std::vector<int> & list, int v, int b) {
+    return std::binary_search(list.begin() + start[v], list.begin() + start[v + 1], b);
+  }
+
+  bool LivenessQuery::is_live_in(int v, int k) const {
+    return live_from(v, k);
+  }
+
+  bool LivenessQuery::is_live_out(int v, int k) const {
+    int b = blockOf[k];
+    if (k + 1 == cfg.start[b + 1]) {
+      return live_out_of_block(v, b);
+    }
+    return live_from(v, k + 1);
+  }
+
+  bool LivenessQuery::live_from(int v, int k) const {
+    int b = blockOf[k];
+    auto first = occurrences.begin() + occurrenceStart[v], last = occurrences.begin() + occurrenceStart[v + 1];
+    auto next = std::lower_bound(first, last, 2 * k);
+    if (next != last && *next / 2 < cfg.start[b + 1]) {
+      return *next % 2 == 1;
+    }
+    return live_out_of_block(v, b);
+  }
+
+  // v is live out of b when some path from a successor of b reaches a block
+  // with an upward-exposed use of v before any block that writes v. Blocks
+  // in SCCs listed before every use of v cannot reach one.
+  bool LivenessQuery::live_out_of_block(int v, int b) const {
+    if (lowestScc[v] > cfg.sccOf[b]) {
+      return false;
+    }
+    if (++epoch == INT_MAX) {
+      std::fill(mark.begin(), mark.end(), 0);
+      epoch = 1;
+    }
+    stack.clear();
+    for (int e = cfg.succStart[b]; e < cfg.succStart[b + 1]; e++) {
+      stack.push_back(cfg.succ[e]);
+    }
+    while (!stack.empty()) {
+      int s = stack.back();
+      stack.pop_back();
+      if (mark[s] == epoch || cfg.sccOf[s] < lowestScc[v]) {
+        continue;
+      }
+      mark[s] = epoch;
+      visited++;
+      if (has(exposedStart, exposed, v, s)) {
+        return true;
+      }
+      if (has(definedStart, defined, v, s)) {
+        continue;
+      }
+      for (int e = cfg.succStart[s]; e < cfg.succStart[s + 1]; e++) {
+        stack.push_back(cfg.succ[e]);
+      }
+    }
+    return false;
+  }
+
+  std::size_t LivenessQuery::bytes() const {
+    std::size_t ints = blockOf.capacity() + occurrenceStart.capacity() + occurrences.capacity()
+                     + exposedStart.capacity() + exposed.capacity() + definedStart.capacity() + defined.capacity()
+                     + lowestScc.capacity() + mark.capacity();
+    return ints * sizeof(int);
+  }
+}
@@ -0,0 +1,81 @@
+// by: Zhiping
+
+#pragma once
+
+#include <vector>
+
+#include <L2.h>
+#include <cfg.h>
+#include <genkill.h>
+
+namespace L2 {
+
+  // On-demand liveness of one function: answers whether a value is live
+  // before or after an instruction without computing any live set.
+  //
+  // This is the liveness checker of Boissinot et al. (precompute what
+  // depends on the CFG only, then answer each query by walking from the
+  // query point towards the uses of the value) adapted to L2, which is not
+  // in SSA form. Without a unique dominating definition a definition does
+  // not bound the walk from above, so instead of their reduced reachability
+  // sets a query searches the blocks forward, stopping at blocks that
+  // define the value, and prunes with the topological order of the SCCs: a
+  // block can only reach a use in an SCC listed no later than its own.
+  //
+  // The constructor records, per value, the instructions that read or write
+  // it, the blocks that read it before any write (upward-exposed uses) and
+  // the blocks that write it. None of it depends
+  // on the value being queried, so the structure stays valid for any number
+  // of queries about any values, as long as the function is not edited.
+  //
+  // Values are dense indices of values(). A query reuses scratch space, so
+  // one LivenessQuery must not be queried from several threads at once.
+  class LivenessQuery {
+  public:
+    explicit LivenessQuery(Function * func);
+
+    const VarIndex & values() const {
+      return vars;
+    }
+
+    const CFG & graph() const {
+      return cfg;
+    }
+
+    // Whether v is live right before (IN) or right after (OUT)
+    // instruction k.
+    bool is_live_in(int v, int k) const;
+    bool is_live_out(int v, int k) const;
+
+    // Blocks entered by the searches of all queries so far.
+    int64_t visits() const {
+      return visited;
+    }
+
+    // Bytes held by the precomputed structure.
+    std::size_t bytes() const;
+
+  private:
+    // Finds the first read or write of v from instruction k to the end of
+    // its block, or else searches the blocks after it.
+    bool live_from(int v, int k) const;
+
+    bool live_out_of_block(int v, int b) const;
+
+    static bool has(const std::vector<int> & start, const std::vector<int> & list, int v, int b);
+
+    VarIndex vars;
+    CFG cfg;
+    std::vector<int> blockOf;                    // instruction -> block
+    std::vector<int> occurrenceStart, occurrences; // value -> 2k + 1 if instruction k reads it, 2k if it
+                                                   // only writes it, increasing
+    std::vector<int> exposedStart, exposed;      // value -> blocks reading it first, increasing
+    std::vector<int> definedStart, defined;      // value -> blocks writing it, increasing
+    std::vector<int> lowestScc;                  // value -> lowest SCC of its exposed blocks
+
+    mutable std::vector<int> mark;               // block -> query that last entered it
+    mutable int epoch = 0;
+    mutable std::vector<int> stack;
+    mutable int64_t visited = 0;
+  };
+}
@@ -0,0 +1,34 @@
+// by: Zhiping
+
+#pragma once
+
+#include <vector>
+
+namespace L2 {
+
+  // Liveness of one function as live ranges.
+  //
+  // The program points are linearised: position 2k is the point before
+  // instruction k (its IN set) and 2k + 1 the point after it (its OUT set).
+  // A range [first, last] says a value is live at every position in between.
+  // The ranges of the value with dense index v are
+  // ranges[rangeStart[v] .. rangeStart[v + 1]), sorted, disjoint and never
+  // adjacent, so the whole result takes space in the number of ranges
+  // instead of instructions times values.
+  struct Range {
+    int first, last;
+  };
+
+  struct LiveRanges {
+    std::vector<int> rangeStart;
+    std::vector<Range> ranges;
+
+    int values() const {
+      return rangeStart.size() - 1;
+    }
+
+    std::size_t bytes() const {
+      return rangeStart.capacity() * sizeof(int) + ranges.capacity() * sizeof(Range);
+    }
+  };
+}
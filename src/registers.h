@@ -0,0 +1,45 @@
+// by: Zhiping
+
+#pragma once
+
+#include <stdint.h>
+
+#include <L2.h>
+
+namespace L2 {
+
+  // The x86-64 register file as seen by liveness. Register r is bit r of a
+  // 16-bit mask, r being its fixed SYMBOL id, so the registers of a live set
+  // are always its low 16 bits and calling-convention effects are constants.
+  const int REGISTERS = SYMBOL::RSP + 1;
+
+  typedef uint16_t regmask_t;
+
+  constexpr regmask_t reg_bit(int r) {
+    return (regmask_t)(1 << r);
+  }
+
+  constexpr regmask_t CALLEE_SAVE = reg_bit(R12) | reg_bit(R13) | reg_bit(R14) | reg_bit(R15) | reg_bit(RBP) | reg_bit(RBX);
+  constexpr regmask_t CALLER_SAVE = reg_bit(R10) | reg_bit(R11) | reg_bit(R8) | reg_bit(R9) | reg_bit(RAX)
+                                  | reg_bit(RCX) | reg_bit(RDI) | reg_bit(RDX) | reg_bit(RSI);
+
+  // Registers read by a return, and written by a call.
+  constexpr regmask_t RETURN_GEN = CALLEE_SAVE | reg_bit(RAX);
+  constexpr regmask_t CALL_KILL = CALLER_SAVE | reg_bit(RAX);
+
+  // ARGS[n]: the registers carrying the first n arguments of a call.
+  const int ARG_REGISTERS = 6;
+  constexpr regmask_t ARGS[ARG_REGISTERS + 1] = {
+    0,
+    reg_bit(RDI),
+    reg_bit(RDI) | reg_bit(RSI),
+    reg_bit(RDI) | reg_bit(RSI) | reg_bit(RDX),
+    reg_bit(RDI) | reg_bit(RSI) | reg_bit(RDX) | reg_bit(RCX),
+    reg_bit(RDI) | reg_bit(RSI) | reg_bit(RDX) | reg_bit(RCX) | reg_bit(R8),
+    reg_bit(RDI) | reg_bit(RSI) | reg_bit(RDX) | reg_bit(RCX) | reg_bit(R8) | reg_bit(R9)
+  };
+
+  inline regmask_t args_mask(int64_t n) {
+    return ARGS[n < 0 ? 0 : n > ARG_REGISTERS ? ARG_REGISTERS : n];
+  }
+}
@@ -0,0 +1,108 @@
+// by: Zhiping
+
+#pragma once
+
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+
+namespace L2 {
+
+  // Buffered output writer.
+  //
+  // Bytes pile up in one buffer that is handed to write(2) in large chunks,
+  // which is what makes printing millions of liveness rows cheap. A writer
+  // built without a file descriptor only buffers, and its contents are taken
+  // with take(); workers use those to format functions in parallel. The
+  // first failed write(2) is kept in error(), and nothing is written after
+  // it.
+  class Writer {
+  public:
+    static const std::size_t CHUNK = 1 << 20;
+
+    explicit Writer(int fd = -1) : fd(fd) {
+      buffer.reserve(fd < 0 ? 4096 : CHUNK);
+    }
+
+    Writer(const Writer &) = delete;
+    Writer & operator=(const Writer &) = delete;
+
+    ~Writer() {
+      flush();
+    }
+
+    void put(char c) {
+      buffer.push_back(c);
+      if (buffer.size() >= CHUNK) {
+        spill();
+      }
+    }
+
+    void write(const char *s, std::size_t n) {
+      buffer.append(s, n);
+      if (buffer.size() >= CHUNK) {
+        spill();
+      }
+    }
+
+    Writer & operator<<(char c) {
+      put(c);
+      return *this;
+    }
+
+    Writer & operator<<(const char *s) {
+      write(s, std::strlen(s));
+      return *this;
+    }
+
+    Writer & operator<<(const std::string & s) {
+      write(s.data(), s.size());
+      return *this;
+    }
+
+    // Hands the buffered bytes over to the caller (memory writers only).
+    std::string take() {
+      std::string s;
+      s.swap(buffer);
+      return s;
+    }
+
+    void flush() {
+      if (fd < 0) {
+        return;
+      }
+      const char *p = buffer.data();
+      std::size_t left = buffer.size();
+      while (left > 0 && failed == 0) {
+        ssize_t n = ::write(fd, p, left);
+        if (n < 0 && errno == EINTR) {
+          continue;
+        }
+        if (n <= 0) {
+          failed = n < 0 ? errno : EIO;
+          break;
+        }
+        p += n;
+        left -= n;
+      }
+      buffer.clear();
+    }
+
+    // The errno of the first failed write, 0 if none failed.
+    int error() const {
+      return failed;
+    }
+
+  private:
+    void spill() {
+      if (fd >= 0) {
+        flush();
+      }
+    }
+
+    int fd;
+    int failed = 0;
+    std::string buffer;
+  };
+}